@@ -32,6 +32,25 @@ if [ ! -f "$DATA_FILE" ]; then
     exit 1
 fi
 
+# Converter uma única vez para o formato binário compacto, evitando
+# refazer o parsing do texto em cada execução. A versão MPI continua no
+# texto: cada processo lê a sua faixa com MPI-IO, enquanto o binário seria
+# decodificado inteiro pelo processo 0.
+CONVERT_EXEC="$PROJECT_ROOT/build/convert_ratings"
+DATA_TEXT="$DATA_FILE"
+DATA_BIN="${DATA_FILE%.txt}.bin"
+if [ -f "$CONVERT_EXEC" ]; then
+    if [ ! -f "$DATA_BIN" ] || [ "$DATA_FILE" -nt "$DATA_BIN" ]; then
+        echo "Convertendo dados para formato binário: $DATA_BIN"
+        "$CONVERT_EXEC" "$DATA_FILE" "$DATA_BIN" > /dev/null || rm -f "$DATA_BIN"
+    fi
+    if [ -f "$DATA_BIN" ]; then
+        DATA_FILE="$DATA_BIN"
+        echo "  Usando arquivo binário: $DATA_FILE"
+        echo ""
+    fi
+fi
+
 # Função para extrair tempo de execução da saída
 extract_time() {
     local result=$(grep "Tempo de execução:" | awk '{print $4}')
@@ -97,9 +116,17 @@ fi
 SEQ_TIMES=()
 for i in $(seq 1 $NUM_RUNS); do
     echo "  Execução $i/$NUM_RUNS..."
-    TIME=$("$SEQ_EXEC" "$DATA_FILE" 2>/dev/null | extract_time)
+    OUTPUT=$("$SEQ_EXEC" "$DATA_FILE" 2>/dev/null)
+    TIME=$(echo "$OUTPUT" | extract_time)
     SEQ_TIMES+=($TIME)
     echo "    Tempo: ${TIME}s"
+
+    # Kernel de similaridade escolhido em tempo de execução (escalar, AVX2 ou AVX-512)
+    if [ "$i" -eq 1 ]; then
+        SIMD_KERNEL=$(echo "$OUTPUT" | grep "Kernel SIMD:" | awk '{print $3}')
+        echo "    Kernel SIMD: ${SIMD_KERNEL:-N/A}"
+        echo "${SIMD_KERNEL:-N/A}" > "$RESULTS_DIR/simd_kernel.txt"
+    fi
 done
 
 # Calcular estatísticas
@@ -237,7 +264,7 @@ for PROCS in "${THREADS_ARRAY[@]}"; do
     
     for i in $(seq 1 $NUM_RUNS); do
         echo "    Execução $i/$NUM_RUNS..."
-        TIME=$(mpirun -np "$PROCS" "$MPI_EXEC" "$DATA_FILE" 2>/dev/null | extract_time)
+        TIME=$(mpirun -np "$PROCS" "$MPI_EXEC" "$DATA_TEXT" 2>/dev/null | extract_time)
         MPI_TIMES+=($TIME)
         echo "      Tempo: ${TIME}s"
     done
@@ -0,0 +1,190 @@
+/**
+ * Relatório de precisão - referência float64 por linha amostrada
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include "accuracy.h"
+#include "topk.h"
+
+typedef struct {
+    double *dot;
+    double *norm1;
+    double *norm2;
+    double *row;
+    float *computed;         // linha do triângulo (denso)
+    ItemSimilarity *heap;
+} ReferenceRow;
+
+/**
+ * Similaridade de `item` com todos os itens, acumulada em double na mesma
+ * ordem crescente de usuário dos motores
+ */
+static void reference_row(const RatingStore *rs, int item, ReferenceRow *ref) {
+    int n = rs->num_items;
+    memset(ref->dot, 0, n * sizeof(double));
+    memset(ref->norm1, 0, n * sizeof(double));
+    memset(ref->norm2, 0, n * sizeof(double));
+
+    for (int k = rs->item_ptr[item]; k < rs->item_ptr[item + 1]; k++) {
+        int user = rs->item_users[k];
+        double r1 = rs->item_ratings[k];
+        for (int p = rs->user_ptr[user]; p < rs->user_ptr[user + 1]; p++) {
+            int j = rs->user_items[p];
+            double r2 = rs->user_ratings[p];
+            ref->dot[j] += r1 * r2;
+            ref->norm1[j] += r1 * r1;
+            ref->norm2[j] += r2 * r2;
+        }
+    }
+
+    for (int j = 0; j < n; j++) {
+        if (j == item || ref->norm1[j] == 0.0 || ref->norm2[j] == 0.0) {
+            ref->row[j] = 0.0;
+        } else {
+            ref->row[j] = ref->dot[j] / (sqrt(ref->norm1[j]) * sqrt(ref->norm2[j]));
+        }
+    }
+}
+
+/**
+ * Os k maiores valores de row (sem o próprio item, zeros ou valores abaixo
+ * de min_similarity) em heap, com as regras de neighbor_index_offer()
+ */
+static int row_top(const float *row, const double *ref_row, int n, int item, int k,
+                   float min_similarity, ItemSimilarity *heap) {
+    int count = 0;
+    for (int j = 0; j < n; j++) {
+        float sim = row ? row[j] : (float)ref_row[j];
+        if (j == item || sim == 0.0 || sim < min_similarity) {
+            continue;
+        }
+        ItemSimilarity candidate = { j, sim };
+        topk_push(heap, &count, k, candidate);
+    }
+    return count;
+}
+
+/**
+ * Lista top-K de referência e quantos de seus itens aparecem na lista calculada
+ */
+static int reference_hits(const NeighborIndex *idx, int item, ReferenceRow *ref, int *expected) {
+    int count = row_top(NULL, ref->row, idx->num_items, item, idx->k, idx->min_similarity,
+                        ref->heap);
+
+    const ItemSimilarity *list = idx->entries + (size_t)item * idx->k;
+    int hits = 0;
+    for (int r = 0; r < count; r++) {
+        for (int q = 0; q < idx->count[item]; q++) {
+            if (list[q].item_id == ref->heap[r].item_id) {
+                hits++;
+                break;
+            }
+        }
+    }
+    *expected = count;
+    return hits;
+}
+
+/**
+ * Matriz densa: quantos dos ACCURACY_DENSE_K vizinhos de referência estão
+ * entre os ACCURACY_DENSE_K maiores valores da linha calculada (um empate
+ * com o último deles conta como acerto)
+ */
+static int dense_hits(int n, int item, ReferenceRow *ref, int *expected) {
+    ItemSimilarity top[ACCURACY_DENSE_K];
+    int top_count = row_top(ref->computed, NULL, n, item, ACCURACY_DENSE_K, -FLT_MAX, top);
+    int count = row_top(NULL, ref->row, n, item, ACCURACY_DENSE_K, -FLT_MAX, ref->heap);
+
+    int hits = 0;
+    for (int r = 0; r < count; r++) {
+        float sim = ref->computed[ref->heap[r].item_id];
+        if (sim != 0.0f && (top_count < ACCURACY_DENSE_K || sim >= top[0].similarity)) {
+            hits++;
+        }
+    }
+    *expected = count;
+    return hits;
+}
+
+int accuracy_report(const RatingStore *rs, const PackedTriangle *triangle,
+                    const NeighborIndex *neighbors, AccuracyReport *report) {
+    int n = rs->num_items;
+    memset(report, 0, sizeof(*report));
+    report->recall = 1.0;
+    report->recall_k = neighbors ? neighbors->k : ACCURACY_DENSE_K;
+    if (n < 2) {
+        return 0;
+    }
+
+    ReferenceRow ref;
+    ref.dot = malloc(n * sizeof(double));
+    ref.norm1 = malloc(n * sizeof(double));
+    ref.norm2 = malloc(n * sizeof(double));
+    ref.row = malloc(n * sizeof(double));
+    ref.computed = malloc(n * sizeof(float));
+    ref.heap = malloc((report->recall_k > 0 ? report->recall_k : 1) * sizeof(ItemSimilarity));
+    int status = 0;
+    if (!ref.dot || !ref.norm1 || !ref.norm2 || !ref.row || !ref.computed || !ref.heap) {
+        fprintf(stderr, "Erro: memória insuficiente para o relatório de precisão\n");
+        status = -1;
+    }
+
+    int step = (n + ACCURACY_MAX_ROWS - 1) / ACCURACY_MAX_ROWS;
+    double sum_error = 0.0;
+    long long hits = 0;
+    long long expected = 0;
+
+    for (int i = 0; i < n && status == 0; i += step) {
+        reference_row(rs, i, &ref);
+        report->rows++;
+
+        int row_expected;
+        if (triangle) {
+            for (int j = 0; j < n; j++) {
+                if (j == i) {
+                    ref.computed[j] = 0.0f;
+                    continue;
+                }
+                ref.computed[j] = packed_triangle_get(triangle, i, j);
+                double error = fabs(ref.computed[j] - ref.row[j]);
+                sum_error += error;
+                if (error > report->max_error) report->max_error = error;
+                report->pairs++;
+            }
+            hits += dense_hits(n, i, &ref, &row_expected);
+        } else {
+            const ItemSimilarity *list = neighbors->entries + (size_t)i * neighbors->k;
+            for (int r = 0; r < neighbors->count[i]; r++) {
+                double error = fabs(list[r].similarity - ref.row[list[r].item_id]);
+                sum_error += error;
+                if (error > report->max_error) report->max_error = error;
+                report->pairs++;
+            }
+            hits += reference_hits(neighbors, i, &ref, &row_expected);
+        }
+        expected += row_expected;
+    }
+
+    report->mean_error = report->pairs > 0 ? sum_error / report->pairs : 0.0;
+    if (expected > 0) {
+        report->recall = (double)hits / expected;
+    }
+
+    free(ref.dot);
+    free(ref.norm1);
+    free(ref.norm2);
+    free(ref.row);
+    free(ref.computed);
+    free(ref.heap);
+    return status;
+}
+
+void accuracy_print(const AccuracyReport *report, FILE *out) {
+    fprintf(out, "\n=== Precisão (referência float64) ===\n");
+    fprintf(out, "Amostra: %d itens, %lld pares\n", report->rows, report->pairs);
+    fprintf(out, "Erro absoluto: máximo %.3e, médio %.3e\n", report->max_error, report->mean_error);
+    fprintf(out, "Recall dos vizinhos top-%d: %.4f\n", report->recall_k, report->recall);
+}
@@ -0,0 +1,40 @@
+/**
+ * Relatório de precisão da similaridade (--accuracy)
+ *
+ * Compara o resultado do build - acumuladores accum_t, triângulo em
+ * FP32/FP16/INT8 ou listas top-K - com uma referência calculada em
+ * float64 (acumulação e divisão em double) sobre uma amostra de linhas.
+ * Serve para escolher a configuração mais rápida dentro da tolerância.
+ */
+
+#ifndef ACCURACY_H
+#define ACCURACY_H
+
+#include <stdio.h>
+#include "ratings.h"
+#include "triangle.h"
+#include "neighbors.h"
+
+// Máximo de linhas (itens) da amostra, espaçadas uniformemente
+#define ACCURACY_MAX_ROWS 512
+// Vizinhos por linha no recall da matriz densa (os mesmos TOP_K das recomendações)
+#define ACCURACY_DENSE_K 10
+
+typedef struct {
+    int rows;              // linhas amostradas
+    long long pairs;       // pares comparados
+    double max_error;      // maior |sim - referência|
+    double mean_error;
+    double recall;         // vizinhos de referência presentes entre os calculados
+    int recall_k;          // K das listas top-K, ou ACCURACY_DENSE_K no denso
+} AccuracyReport;
+
+/**
+ * Exatamente um de triangle e neighbors deve ser não nulo
+ */
+int accuracy_report(const RatingStore *rs, const PackedTriangle *triangle,
+                    const NeighborIndex *neighbors, AccuracyReport *report);
+
+void accuracy_print(const AccuracyReport *report, FILE *out);
+
+#endif
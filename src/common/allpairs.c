@@ -0,0 +1,83 @@
+/**
+ * Motor exato por índice invertido - só os pares com avaliador comum
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "allpairs.h"
+#include "simd.h"
+
+int allpairs_workspace_init(AllPairsWorkspace *ws, int num_items) {
+    memset(ws, 0, sizeof(*ws));
+    ws->num_items = num_items;
+    ws->accum = calloc(num_items > 0 ? num_items : 1, sizeof(PairAccum));
+    ws->seen = calloc(num_items > 0 ? num_items : 1, 1);
+    ws->items = malloc((num_items > 0 ? num_items : 1) * sizeof(int));
+    ws->sims = malloc((num_items > 0 ? num_items : 1) * sizeof(float));
+    if (!ws->accum || !ws->seen || !ws->items || !ws->sims) {
+        fprintf(stderr, "Erro: memória insuficiente para o índice de %d itens\n", num_items);
+        allpairs_workspace_free(ws);
+        return -1;
+    }
+    return 0;
+}
+
+void allpairs_workspace_free(AllPairsWorkspace *ws) {
+    free(ws->accum);
+    free(ws->seen);
+    free(ws->items);
+    free(ws->sims);
+    memset(ws, 0, sizeof(*ws));
+}
+
+/**
+ * Primeira posição da linha CSR do usuário com item >= first
+ */
+static int first_at_least(const RatingStore *rs, int user, int first) {
+    int lo = rs->user_ptr[user];
+    int hi = rs->user_ptr[user + 1];
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (rs->user_items[mid] < first) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+int allpairs_row(const RatingStore *rs, int item, int col_begin, int col_end,
+                 AllPairsWorkspace *ws) {
+    int first = item + 1 > col_begin ? item + 1 : col_begin;
+    int count = 0;
+
+    // Usuários de item em ordem crescente: mesma ordem de soma do par (item, j)
+    for (int k = rs->item_ptr[item]; k < rs->item_ptr[item + 1]; k++) {
+        int user = rs->item_users[k];
+        accum_t r1 = rs->item_ratings[k];
+        int p_end = rs->user_ptr[user + 1];
+        for (int p = first_at_least(rs, user, first); p < p_end && rs->user_items[p] < col_end; p++) {
+            int j = rs->user_items[p];
+            accum_t r2 = rs->user_ratings[p];
+            if (!ws->seen[j]) {
+                ws->seen[j] = 1;
+                ws->items[count++] = j;
+            }
+            PairAccum *acc = &ws->accum[j];
+            acc->dot += r1 * r2;
+            acc->norm1 += r1 * r1;
+            acc->norm2 += r2 * r2;
+        }
+    }
+
+    for (int c = 0; c < count; c++) {
+        int j = ws->items[c];
+        simd_cosine_finalize(&ws->accum[j].dot, &ws->sims[c], 1);
+        memset(&ws->accum[j], 0, sizeof(PairAccum));
+        ws->seen[j] = 0;
+    }
+    ws->pairs += count;
+    return count;
+}
@@ -0,0 +1,47 @@
+/**
+ * Motor exato por índice invertido (--engine=allpairs)
+ *
+ * No estilo do AllPairs, cada item i sonda o índice invertido dos itens
+ * j > i: para cada avaliador u de i, o sufixo da linha CSR de u depois de
+ * i (as linhas são ordenadas, então o sufixo é o índice incremental). Só
+ * os pares com algum avaliador comum são acumulados e finalizados; os
+ * demais têm similaridade 0 e são descartados sem custo, inclusive antes
+ * de chegar ao triângulo ou ao índice top-K.
+ *
+ * Os filtros de prefixo e de norma do AllPairs/L2AP não se aplicam: aqui
+ * as normas são calculadas só sobre os avaliadores comuns (cosine_sparse),
+ * então qualquer par com um avaliador comum pode chegar a 1 e nenhum
+ * limiar ou piso top-K permite descartá-lo antes do cálculo. O limiar
+ * (--min-sim) e o piso continuam aplicados pelo índice de vizinhos.
+ */
+
+#ifndef ALLPAIRS_H
+#define ALLPAIRS_H
+
+#include "ratings.h"
+#include "blocked.h"
+
+/**
+ * Memória de trabalho de uma thread; não compartilhar
+ */
+typedef struct {
+    int num_items;
+    PairAccum *accum;       // num_items, zerados entre linhas
+    unsigned char *seen;    // num_items: 1 se o item já está em items
+    int *items;             // itens j da última linha, na ordem de descoberta
+    float *sims;            // similaridade de cada items[c]
+    long long pairs;        // pares com avaliador comum calculados (acumulado)
+} AllPairsWorkspace;
+
+int allpairs_workspace_init(AllPairsWorkspace *ws, int num_items);
+void allpairs_workspace_free(AllPairsWorkspace *ws);
+
+/**
+ * Pares (item, j) com col_begin <= j < col_end, j > item e algum
+ * avaliador comum: preenche ws->items/ws->sims e retorna quantos são. O
+ * valor é idêntico ao de cosine_similarity(item, j).
+ */
+int allpairs_row(const RatingStore *rs, int item, int col_begin, int col_end,
+                 AllPairsWorkspace *ws);
+
+#endif
@@ -0,0 +1,133 @@
+/**
+ * Motor em blocos - produto esparso R^T R em ladrilhos do tamanho da L2
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "blocked.h"
+#include "simd.h"
+
+int blocked_default_block_size(void) {
+    int side = (int)sqrt((double)BLOCKED_L2_BYTES / sizeof(PairAccum));
+    side -= side % 16;
+    return side > 16 ? side : 16;
+}
+
+int blocked_workspace_init(BlockWorkspace *ws, int block_size) {
+    memset(ws, 0, sizeof(*ws));
+    ws->block_size = block_size > 0 ? block_size : blocked_default_block_size();
+    ws->tile = malloc((size_t)ws->block_size * ws->block_size * sizeof(PairAccum));
+    ws->row = malloc(ws->block_size * sizeof(float));
+    if (!ws->tile || !ws->row) {
+        fprintf(stderr, "Erro: memória insuficiente para ladrilho %dx%d\n",
+                ws->block_size, ws->block_size);
+        blocked_workspace_free(ws);
+        return -1;
+    }
+    return 0;
+}
+
+void blocked_workspace_free(BlockWorkspace *ws) {
+    free(ws->tile);
+    free(ws->row);
+    free(ws->cursor);
+    memset(ws, 0, sizeof(*ws));
+}
+
+/**
+ * Primeira posição da linha CSR do usuário com item > item
+ */
+static int first_after(const RatingStore *rs, int user, int item) {
+    int lo = rs->user_ptr[user];
+    int hi = rs->user_ptr[user + 1];
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (rs->user_items[mid] <= item) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+int similarity_blocked_rows(const RatingStore *rs, int row_begin, int row_end,
+                            BlockWorkspace *ws, SimilarityRowSink sink, void *ctx) {
+    return similarity_blocked_block(rs, row_begin, row_end, 0, rs->num_items, ws, sink, ctx);
+}
+
+int similarity_blocked_block(const RatingStore *rs, int row_begin, int row_end,
+                             int col_begin, int col_end, BlockWorkspace *ws,
+                             SimilarityRowSink sink, void *ctx) {
+    int B = ws->block_size;
+    int n = col_end < rs->num_items ? col_end : rs->num_items;
+    if (row_end > rs->num_items) row_end = rs->num_items;
+
+    for (int i0 = row_begin; i0 < row_end; i0 += B) {
+        int i1 = i0 + B < row_end ? i0 + B : row_end;
+        int base = rs->item_ptr[i0];
+        int entries = rs->item_ptr[i1] - base;
+
+        // Um cursor por avaliação (u, i) do bloco: posição em row(u) após i
+        // (e a partir da primeira coluna)
+        if (entries > ws->cursor_capacity) {
+            int *grown = realloc(ws->cursor, entries * sizeof(int));
+            if (!grown) {
+                fprintf(stderr, "Erro: memória insuficiente para cursores do bloco\n");
+                return -1;
+            }
+            ws->cursor = grown;
+            ws->cursor_capacity = entries;
+        }
+        for (int i = i0; i < i1; i++) {
+            for (int k = rs->item_ptr[i]; k < rs->item_ptr[i + 1]; k++) {
+                ws->cursor[k - base] = first_after(rs, rs->item_users[k],
+                                                   i >= col_begin ? i : col_begin - 1);
+            }
+        }
+
+        // Ladrilhos J à direita (e sobre a diagonal) do bloco I
+        for (int j0 = i0 > col_begin ? i0 : col_begin; j0 < n; j0 += B) {
+            int j1 = j0 + B < n ? j0 + B : n;
+            int width = j1 - j0;
+
+            for (int i = i0; i < i1; i++) {
+                memset(ws->tile + (size_t)(i - i0) * B, 0, width * sizeof(PairAccum));
+            }
+
+            // Acumula usuário a usuário, em ordem crescente por par (i, j)
+            for (int i = i0; i < i1; i++) {
+                PairAccum *acc_row = ws->tile + (size_t)(i - i0) * B;
+                for (int k = rs->item_ptr[i]; k < rs->item_ptr[i + 1]; k++) {
+                    int user = rs->item_users[k];
+                    accum_t r1 = rs->item_ratings[k];
+                    int p = ws->cursor[k - base];
+                    int end = rs->user_ptr[user + 1];
+
+                    while (p < end && rs->user_items[p] < j1) {
+                        accum_t r2 = rs->user_ratings[p];
+                        PairAccum *acc = &acc_row[rs->user_items[p] - j0];
+                        acc->dot += r1 * r2;
+                        acc->norm1 += r1 * r1;
+                        acc->norm2 += r2 * r2;
+                        p++;
+                    }
+                    ws->cursor[k - base] = p;
+                }
+            }
+
+            // Converte os acumuladores em similaridades
+            for (int i = i0; i < i1; i++) {
+                int first = i + 1 > j0 ? i + 1 : j0;
+                if (first >= j1) continue;
+
+                const PairAccum *acc_row = ws->tile + (size_t)(i - i0) * B;
+                simd_cosine_finalize(&acc_row[first - j0].dot, ws->row, j1 - first);
+                sink(i, first, ws->row, j1 - first, ctx);
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,73 @@
+/**
+ * Motor em blocos para a matriz de similaridade completa
+ *
+ * Em vez de n²/2 chamadas independentes de par, cada bloco de linhas I
+ * percorre uma única vez as avaliações de seus itens e acumula, usuário a
+ * usuário, o produto interno e as normas parciais de todos os pares (i, j)
+ * de um ladrilho I x J (produto esparso R^T R em ladrilhos). O ladrilho de
+ * acumuladores é dimensionado para caber na cache L2.
+ */
+
+#ifndef BLOCKED_H
+#define BLOCKED_H
+
+#include "ratings.h"
+#include "similarity.h"
+
+// Tamanho de L2 assumido para dimensionar o ladrilho padrão
+#define BLOCKED_L2_BYTES (256 * 1024)
+
+// Três accum_t consecutivos: o layout esperado por simd_cosine_finalize()
+typedef struct {
+    accum_t dot;
+    accum_t norm1;
+    accum_t norm2;
+} PairAccum;
+
+/**
+ * Recebe um segmento da linha `item` com as similaridades dos itens
+ * first .. first + count - 1 (sempre first > item)
+ */
+typedef void (*SimilarityRowSink)(int item, int first, const float *sims,
+                                  int count, void *ctx);
+
+/**
+ * Memória de trabalho de uma thread (ladrilho + cursores); não compartilhar
+ */
+typedef struct {
+    int block_size;
+    PairAccum *tile;
+    float *row;
+    int *cursor;
+    int cursor_capacity;
+} BlockWorkspace;
+
+/**
+ * Lado do ladrilho que cabe em BLOCKED_L2_BYTES (múltiplo de 16)
+ */
+int blocked_default_block_size(void);
+
+/**
+ * block_size <= 0 usa blocked_default_block_size()
+ */
+int blocked_workspace_init(BlockWorkspace *ws, int block_size);
+void blocked_workspace_free(BlockWorkspace *ws);
+
+/**
+ * Calcula as similaridades de cosseno de todos os pares (i, j) com
+ * row_begin <= i < row_end e j > i, entregando-as a `sink` por segmentos
+ * de linha. O resultado é idêntico ao de cosine_similarity(i, j).
+ * Retorna 0 ou -1 se faltar memória para os cursores.
+ */
+int similarity_blocked_rows(const RatingStore *rs, int row_begin, int row_end,
+                            BlockWorkspace *ws, SimilarityRowSink sink, void *ctx);
+
+/**
+ * Como similarity_blocked_rows(), restrito às colunas col_begin <= j < col_end
+ * (um bloco do espaço de pares, partition.h)
+ */
+int similarity_blocked_block(const RatingStore *rs, int row_begin, int row_end,
+                             int col_begin, int col_end, BlockWorkspace *ws,
+                             SimilarityRowSink sink, void *ctx);
+
+#endif
@@ -0,0 +1,243 @@
+/**
+ * Dicionário de IDs externos - hash na leitura, tabela ordenada depois
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "idmap.h"
+
+#define ID_MAP_INITIAL_SLOTS 1024
+
+static uint64_t hash_key(const char *key, size_t len) {
+    // FNV-1a de 64 bits
+    uint64_t hash = 1469598103934665603ULL;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)key[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static size_t key_length(const IdMap *map, int id) {
+    return map->offsets[id + 1] - map->offsets[id] - 1;
+}
+
+int id_map_init(IdMap *map) {
+    memset(map, 0, sizeof(*map));
+    map->offsets_capacity = 1024;
+    map->keys_capacity = 8192;
+    map->num_slots = ID_MAP_INITIAL_SLOTS;
+    map->offsets = malloc((map->offsets_capacity + 1) * sizeof(uint64_t));
+    map->keys = malloc(map->keys_capacity);
+    map->slots = calloc(map->num_slots, sizeof(int));
+    if (!map->offsets || !map->keys || !map->slots) {
+        id_map_free(map);
+        return -1;
+    }
+    map->offsets[0] = 0;
+    return 0;
+}
+
+void id_map_free(IdMap *map) {
+    free(map->offsets);
+    free(map->keys);
+    free(map->slots);
+    memset(map, 0, sizeof(*map));
+}
+
+/**
+ * Dobra a tabela hash e reinsere os índices (as chaves não mudam de lugar)
+ */
+static int grow_slots(IdMap *map) {
+    size_t num_slots = map->num_slots * 2;
+    int *slots = calloc(num_slots, sizeof(int));
+    if (!slots) {
+        return -1;
+    }
+    for (int id = 0; id < map->count; id++) {
+        size_t s = hash_key(id_map_key(map, id), key_length(map, id)) & (num_slots - 1);
+        while (slots[s]) s = (s + 1) & (num_slots - 1);
+        slots[s] = id + 1;
+    }
+    free(map->slots);
+    map->slots = slots;
+    map->num_slots = num_slots;
+    return 0;
+}
+
+/**
+ * Posição da chave na tabela hash, ou a posição vazia onde ela entraria
+ */
+static size_t find_slot(const IdMap *map, const char *key, size_t len) {
+    size_t mask = map->num_slots - 1;
+    size_t s = hash_key(key, len) & mask;
+    while (map->slots[s]) {
+        int id = map->slots[s] - 1;
+        if (key_length(map, id) == len && memcmp(id_map_key(map, id), key, len) == 0) {
+            break;
+        }
+        s = (s + 1) & mask;
+    }
+    return s;
+}
+
+int id_map_insert(IdMap *map, const char *key, size_t len) {
+    size_t s = find_slot(map, key, len);
+    if (map->slots[s]) {
+        return map->slots[s] - 1;
+    }
+
+    if (map->count == map->offsets_capacity) {
+        int capacity = map->offsets_capacity * 2;
+        uint64_t *grown = realloc(map->offsets, (capacity + 1) * sizeof(uint64_t));
+        if (!grown) return -1;
+        map->offsets = grown;
+        map->offsets_capacity = capacity;
+    }
+    size_t used = map->offsets[map->count];
+    if (used + len + 1 > map->keys_capacity) {
+        size_t capacity = map->keys_capacity * 2;
+        while (used + len + 1 > capacity) capacity *= 2;
+        char *grown = realloc(map->keys, capacity);
+        if (!grown) return -1;
+        map->keys = grown;
+        map->keys_capacity = capacity;
+    }
+
+    memcpy(map->keys + used, key, len);
+    map->keys[used + len] = '\0';
+    int id = map->count++;
+    map->offsets[map->count] = used + len + 1;
+    map->slots[s] = id + 1;
+
+    // Fator de carga até 1/2
+    if ((size_t)map->count * 2 > map->num_slots && grow_slots(map) != 0) {
+        return -1;
+    }
+    return id;
+}
+
+/**
+ * Número decimal sem sinal e sem zeros à esquerda ("0" incluído)
+ */
+static int is_number(const char *key, size_t len) {
+    if (len == 0 || (key[0] == '0' && len > 1)) {
+        return 0;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (key[i] < '0' || key[i] > '9') return 0;
+    }
+    return 1;
+}
+
+/**
+ * Ordem canônica: números pelo valor (comprimento e depois dígitos, sem
+ * limite de tamanho), antes dos demais tokens, comparados byte a byte
+ */
+static int compare_canonical(const char *a, size_t a_len, int a_number,
+                             const char *b, size_t b_len, int b_number) {
+    if (a_number != b_number) {
+        return a_number ? -1 : 1;
+    }
+    if (a_number && a_len != b_len) {
+        return a_len < b_len ? -1 : 1;
+    }
+    int c = memcmp(a, b, a_len < b_len ? a_len : b_len);
+    if (c != 0) {
+        return c;
+    }
+    return (a_len > b_len) - (a_len < b_len);
+}
+
+int id_map_find(const IdMap *map, const char *key, size_t len) {
+    if (map->slots) {
+        size_t s = find_slot(map, key, len);
+        return map->slots[s] - 1;
+    }
+
+    int number = is_number(key, len);
+    int lo = 0;
+    int hi = map->count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        const char *other = id_map_key(map, mid);
+        size_t other_len = key_length(map, mid);
+        int c = compare_canonical(other, other_len, is_number(other, other_len),
+                                  key, len, number);
+        if (c == 0) return mid;
+        if (c < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return -1;
+}
+
+const char *id_map_label(const IdMap *map, int id, char *buffer) {
+    if (map && id >= 0 && id < map->count) {
+        return id_map_key(map, id);
+    }
+    snprintf(buffer, ID_MAP_LABEL_SIZE, "%d", id);
+    return buffer;
+}
+
+typedef struct {
+    const char *key;
+    size_t len;
+    int number;
+    int id;
+} SortKey;
+
+static int compare_sort_key(const void *a, const void *b) {
+    const SortKey *ka = (const SortKey *)a;
+    const SortKey *kb = (const SortKey *)b;
+    return compare_canonical(ka->key, ka->len, ka->number, kb->key, kb->len, kb->number);
+}
+
+int id_map_sort(IdMap *map, const unsigned char *keep, int max_count, int *remap) {
+    SortKey *order = malloc((map->count > 0 ? map->count : 1) * sizeof(SortKey));
+    if (!order) {
+        return -1;
+    }
+    int kept = 0;
+    for (int id = 0; id < map->count; id++) {
+        remap[id] = -1;
+        if (!keep || keep[id]) {
+            const char *key = id_map_key(map, id);
+            size_t len = key_length(map, id);
+            order[kept++] = (SortKey){ key, len, is_number(key, len), id };
+        }
+    }
+    qsort(order, kept, sizeof(SortKey), compare_sort_key);
+    if (max_count > 0 && kept > max_count) {
+        kept = max_count;
+    }
+
+    uint64_t bytes = 0;
+    for (int k = 0; k < kept; k++) {
+        bytes += order[k].len + 1;
+    }
+    uint64_t *offsets = malloc((kept + 1) * sizeof(uint64_t));
+    char *keys = malloc(bytes > 0 ? bytes : 1);
+    if (!offsets || !keys) {
+        free(offsets);
+        free(keys);
+        free(order);
+        return -1;
+    }
+
+    offsets[0] = 0;
+    for (int k = 0; k < kept; k++) {
+        memcpy(keys + offsets[k], order[k].key, order[k].len + 1);
+        offsets[k + 1] = offsets[k] + order[k].len + 1;
+        remap[order[k].id] = k;
+    }
+    free(order);
+
+    id_map_free(map);
+    map->count = kept;
+    map->offsets = offsets;
+    map->keys = keys;
+    return 0;
+}
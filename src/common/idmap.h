@@ -0,0 +1,77 @@
+/**
+ * Dicionário de IDs externos (--remap-ids)
+ *
+ * Sem remapeamento, o ID lido do arquivo é o próprio índice nos vetores:
+ * num_users/num_items são o maior ID + 1 e um único ID alto aloca (e faz
+ * percorrer) toda a faixa até ele. Com o dicionário, cada token distinto
+ * de usuário ou item (número de qualquer tamanho ou texto sem espaços)
+ * recebe um índice denso 0 .. count - 1 e o custo passa a depender só do
+ * número de IDs distintos.
+ *
+ * Durante a leitura, o mapa é uma tabela hash (endereçamento aberto) sobre
+ * as chaves. Depois, id_map_sort() fixa a ordem canônica das chaves: os
+ * números sem zeros à esquerda primeiro, pelo valor, e depois os demais
+ * tokens em ordem de bytes. A ordem não depende da ordem do arquivo e, se
+ * os IDs já forem 0 .. n - 1, o índice denso é o próprio ID. A tabela
+ * ordenada (offsets + chaves terminadas em '\0') é a forma gravada no
+ * modelo; nela as buscas são binárias, sem reconstruir o hash.
+ */
+
+#ifndef IDMAP_H
+#define IDMAP_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+    int count;
+    uint64_t *offsets;     // count + 1: chave k em keys + offsets[k] (com '\0')
+    char *keys;
+
+    // Construção (NULL/0 num mapa ordenado ou lido de um modelo)
+    int *slots;            // índice + 1 de cada posição da tabela hash; 0: vazia
+    size_t num_slots;      // potência de 2
+    int offsets_capacity;
+    size_t keys_capacity;
+} IdMap;
+
+// Buffer de id_map_label()
+#define ID_MAP_LABEL_SIZE 16
+
+int id_map_init(IdMap *map);
+void id_map_free(IdMap *map);
+
+/**
+ * Índice da chave (key[0 .. len - 1]), inserindo-a se for nova; -1 se
+ * faltar memória. Só antes de id_map_sort().
+ */
+int id_map_insert(IdMap *map, const char *key, size_t len);
+
+/**
+ * Índice da chave ou -1: pelo hash durante a construção, por busca binária
+ * num mapa ordenado
+ */
+int id_map_find(const IdMap *map, const char *key, size_t len);
+
+/**
+ * Chave do índice id (terminada em '\0')
+ */
+static inline const char *id_map_key(const IdMap *map, int id) {
+    return map->keys + map->offsets[id];
+}
+
+/**
+ * Texto do ID externo: a chave ou, sem mapa (map == NULL) ou fora dele,
+ * o próprio número escrito em buffer (ID_MAP_LABEL_SIZE bytes)
+ */
+const char *id_map_label(const IdMap *map, int id, char *buffer);
+
+/**
+ * Reordena as chaves na ordem canônica, mantendo só as com keep[id] != 0
+ * (keep == NULL: todas) e no máximo max_count (<= 0: sem limite), e
+ * descarta o hash. remap[id antigo] recebe o novo índice ou -1.
+ */
+int id_map_sort(IdMap *map, const unsigned char *keep, int max_count, int *remap);
+
+#endif
@@ -0,0 +1,237 @@
+/**
+ * Atualização incremental da similaridade - aplicação do delta e linhas avulsas
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "incremental.h"
+#include "simd.h"
+
+typedef struct {
+    int user_id;
+    int item_id;
+    int seq;
+    float rating;
+} DeltaEntry;
+
+static int compare_delta(const void *a, const void *b) {
+    const DeltaEntry *ea = (const DeltaEntry *)a;
+    const DeltaEntry *eb = (const DeltaEntry *)b;
+
+    if (ea->user_id != eb->user_id) return ea->user_id < eb->user_id ? -1 : 1;
+    if (ea->item_id != eb->item_id) return ea->item_id < eb->item_id ? -1 : 1;
+    return ea->seq < eb->seq ? -1 : (ea->seq > eb->seq);
+}
+
+/**
+ * Marca item em touched (sem repetição)
+ */
+static void touch(RatingDelta *changes, int item) {
+    if (!changes->is_touched[item]) {
+        changes->is_touched[item] = 1;
+        changes->touched[changes->num_touched++] = item;
+    }
+}
+
+int rating_store_apply_delta(RatingStore *out, const RatingStore *base,
+                             const Rating *delta, int count, RatingDelta *changes) {
+    memset(out, 0, sizeof(*out));
+    memset(changes, 0, sizeof(*changes));
+
+    // O delta traz IDs numéricos usados como índice: não há como situá-los
+    // no dicionário de um modelo remapeado sem renumerar os itens gravados
+    if (base->user_ids || base->item_ids) {
+        fprintf(stderr, "Erro: atualização incremental de modelo com IDs remapeados "
+                "não suportada\n");
+        return -1;
+    }
+
+    out->num_users = base->num_users;
+    out->num_items = base->num_items;
+    DeltaEntry *entries = malloc((count > 0 ? count : 1) * sizeof(DeltaEntry));
+    if (!entries) {
+        fprintf(stderr, "Erro: memória insuficiente para %d avaliações do delta\n", count);
+        return -1;
+    }
+    for (int k = 0; k < count; k++) {
+        entries[k].user_id = delta[k].user_id;
+        entries[k].item_id = delta[k].item_id;
+        entries[k].seq = k;
+        entries[k].rating = delta[k].rating;
+        if (delta[k].user_id >= out->num_users) out->num_users = delta[k].user_id + 1;
+        if (delta[k].item_id >= out->num_items) out->num_items = delta[k].item_id + 1;
+    }
+    qsort(entries, count, sizeof(DeltaEntry), compare_delta);
+
+    int capacity = base->num_ratings + count;
+    out->user_ptr = calloc(out->num_users + 1, sizeof(int));
+    out->user_items = malloc((capacity > 0 ? capacity : 1) * sizeof(int));
+    out->user_ratings = malloc((capacity > 0 ? capacity : 1) * sizeof(float));
+    changes->changed = malloc((out->num_items > 0 ? out->num_items : 1) * sizeof(int));
+    changes->is_changed = calloc(out->num_items > 0 ? out->num_items : 1, 1);
+    changes->touched = malloc((out->num_items > 0 ? out->num_items : 1) * sizeof(int));
+    changes->is_touched = calloc(out->num_items > 0 ? out->num_items : 1, 1);
+    if (!out->user_ptr || !out->user_items || !out->user_ratings || !changes->changed ||
+        !changes->is_changed || !changes->touched || !changes->is_touched) {
+        fprintf(stderr, "Erro: memória insuficiente para aplicar o delta\n");
+        free(entries);
+        rating_store_free(out);
+        rating_delta_free(changes);
+        return -1;
+    }
+
+    // Intercala, usuário a usuário, a linha CSR antiga com as entradas do delta
+    int nnz = 0;
+    int d = 0;
+    for (int u = 0; u < out->num_users; u++) {
+        int p = u < base->num_users ? base->user_ptr[u] : 0;
+        int p_end = u < base->num_users ? base->user_ptr[u + 1] : 0;
+        int row_start = nnz;
+        int user_changed = 0;
+
+        while (p < p_end || (d < count && entries[d].user_id == u)) {
+            int from_delta = d < count && entries[d].user_id == u &&
+                             (p == p_end || entries[d].item_id <= base->user_items[p]);
+            if (!from_delta) {
+                out->user_items[nnz] = base->user_items[p];
+                out->user_ratings[nnz] = base->user_ratings[p];
+                nnz++;
+                p++;
+                continue;
+            }
+
+            // Última ocorrência do item no delta vence
+            int item = entries[d].item_id;
+            while (d + 1 < count && entries[d + 1].user_id == u && entries[d + 1].item_id == item) {
+                d++;
+            }
+            float rating = entries[d].rating > 0 ? entries[d].rating : 0.0f;
+            d++;
+
+            float old = 0.0f;
+            if (p < p_end && base->user_items[p] == item) {
+                old = base->user_ratings[p];
+                p++;
+            }
+            if (rating != old) {
+                changes->num_updates++;
+                user_changed = 1;
+                if (!changes->is_changed[item]) {
+                    changes->is_changed[item] = 1;
+                    changes->changed[changes->num_changed++] = item;
+                }
+                touch(changes, item);
+            }
+            if (rating > 0) {
+                out->user_items[nnz] = item;
+                out->user_ratings[nnz] = rating;
+                nnz++;
+            }
+        }
+
+        if (user_changed) {
+            changes->num_users++;
+            for (int k = row_start; k < nnz; k++) {
+                touch(changes, out->user_items[k]);
+            }
+        }
+        out->user_ptr[u + 1] = nnz;
+    }
+    out->num_ratings = nnz;
+
+    free(entries);
+    return rating_store_build_csc(out);
+}
+
+int rating_delta_check_ids(const RatingStore *base, int remap_ids) {
+    int keyed = base->user_ids || base->item_ids;
+    if (remap_ids && !keyed) {
+        fprintf(stderr, "Erro: --update com --remap-ids, mas o modelo não tem dicionário de IDs "
+                "(foi gravado sem --remap-ids)\n");
+        return -1;
+    }
+    if (keyed && !remap_ids) {
+        fprintf(stderr, "Erro: o modelo usa IDs remapeados; os IDs numéricos do delta não "
+                "são índices dele\n");
+        return -1;
+    }
+    if (keyed) {
+        fprintf(stderr, "Erro: atualização incremental de modelo com IDs remapeados "
+                "não suportada\n");
+        return -1;
+    }
+    return 0;
+}
+
+void rating_delta_free(RatingDelta *changes) {
+    free(changes->changed);
+    free(changes->is_changed);
+    free(changes->touched);
+    free(changes->is_touched);
+    memset(changes, 0, sizeof(*changes));
+}
+
+int rating_delta_rows(RatingDelta *changes, const RatingStore *rs, SimilarityMetric metric,
+                      int top_k, const int **rows, const unsigned char **is_row) {
+    if (top_k > 0 && metric == METRIC_PEARSON) {
+        for (int c = 0; c < changes->num_changed; c++) {
+            int item = changes->changed[c];
+            for (int k = rs->item_ptr[item]; k < rs->item_ptr[item + 1]; k++) {
+                int user = rs->item_users[k];
+                for (int p = rs->user_ptr[user]; p < rs->user_ptr[user + 1]; p++) {
+                    touch(changes, rs->user_items[p]);
+                }
+            }
+        }
+    }
+    if (top_k > 0 || metric == METRIC_ADJUSTED) {
+        *rows = changes->touched;
+        *is_row = changes->is_touched;
+        return changes->num_touched;
+    }
+    *rows = changes->changed;
+    *is_row = changes->is_changed;
+    return changes->num_changed;
+}
+
+int row_workspace_init(RowWorkspace *ws, int num_items) {
+    ws->num_items = num_items;
+    ws->accum = malloc((num_items > 0 ? num_items : 1) * sizeof(PairAccum));
+    ws->row = malloc((num_items > 0 ? num_items : 1) * sizeof(float));
+    if (!ws->accum || !ws->row) {
+        fprintf(stderr, "Erro: memória insuficiente para linha de %d itens\n", num_items);
+        row_workspace_free(ws);
+        return -1;
+    }
+    return 0;
+}
+
+void row_workspace_free(RowWorkspace *ws) {
+    free(ws->accum);
+    free(ws->row);
+    memset(ws, 0, sizeof(*ws));
+}
+
+void similarity_item_row(const RatingStore *rs, int item, RowWorkspace *ws) {
+    int n = rs->num_items;
+    memset(ws->accum, 0, n * sizeof(PairAccum));
+
+    // Usuários de item em ordem crescente: mesma ordem de soma do par (item, j)
+    for (int k = rs->item_ptr[item]; k < rs->item_ptr[item + 1]; k++) {
+        int user = rs->item_users[k];
+        accum_t r1 = rs->item_ratings[k];
+        for (int p = rs->user_ptr[user]; p < rs->user_ptr[user + 1]; p++) {
+            accum_t r2 = rs->user_ratings[p];
+            PairAccum *acc = &ws->accum[rs->user_items[p]];
+            acc->dot += r1 * r2;
+            acc->norm1 += r1 * r1;
+            acc->norm2 += r2 * r2;
+        }
+    }
+
+    if (n > 0) {
+        simd_cosine_finalize(&ws->accum[0].dot, ws->row, n);
+        ws->row[item] = 0.0;
+    }
+}
@@ -0,0 +1,85 @@
+/**
+ * Atualização incremental da similaridade a partir de um delta de avaliações
+ *
+ * Um delta é um arquivo de triplas "user_id item_id rating" novas ou
+ * alteradas (nota <= 0 remove a avaliação). Um par (i, j) só muda se algum
+ * usuário do delta avaliou i e j, então basta refazer:
+ *   - matriz densa: as linhas (e colunas) dos itens com avaliação alterada;
+ *   - índice top-K: as listas de todos os itens avaliados, antes ou depois,
+ *     pelos usuários do delta (os demais pares dessas listas podem ter
+ *     entrado ou saído do top-K).
+ * Cada linha é recalculada a partir das estatísticas suficientes do par
+ * (produto interno e normas sobre os co-avaliadores), acumuladas só sobre
+ * os usuários que avaliaram o item, com resultado idêntico a um build
+ * completo.
+ */
+
+#ifndef INCREMENTAL_H
+#define INCREMENTAL_H
+
+#include "ratings.h"
+#include "blocked.h"
+#include "metric.h"
+
+typedef struct {
+    int num_updates;        // avaliações inseridas, alteradas ou removidas
+    int num_users;          // usuários com alguma avaliação alterada
+    int *changed;           // itens com alguma avaliação alterada
+    int num_changed;
+    unsigned char *is_changed;  // num_items posições: 1 se o item está em changed
+    int *touched;           // itens avaliados (antes ou depois) pelos usuários alterados
+    int num_touched;
+    unsigned char *is_touched;  // num_items posições: 1 se o item está em touched
+} RatingDelta;
+
+/**
+ * Aplica `delta` (na ordem do arquivo; a última ocorrência vence) sobre as
+ * avaliações de `base` e constrói `out` com as visões CSR/CSC. base só
+ * precisa da visão CSR e não é modificado (pode vir de um modelo mapeado).
+ * Modelos com IDs remapeados (idmap.h) são recusados.
+ */
+int rating_store_apply_delta(RatingStore *out, const RatingStore *base,
+                             const Rating *delta, int count, RatingDelta *changes);
+
+/**
+ * Confere, antes de ler o delta, se os IDs do delta combinam com o modelo:
+ * --remap-ids exige um modelo com dicionário, e um modelo com dicionário
+ * (ainda não suportado pela atualização) não aceita IDs numéricos crus
+ */
+int rating_delta_check_ids(const RatingStore *base, int remap_ids);
+
+void rating_delta_free(RatingDelta *changes);
+
+/**
+ * Linhas a recalcular (changed ou touched, conforme o cabeçalho) e a marca
+ * de pertinência correspondente; retorna quantas são. rs são as avaliações
+ * já atualizadas. Com as métricas centradas (metric.h) mudam também as médias:
+ *   - cosseno ajustado: a média de cada usuário do delta muda todos os
+ *     pares dos itens que ele avaliou, então a matriz densa também refaz
+ *     as linhas tocadas;
+ *   - Pearson: a média de um item alterado muda seus pares com todo item
+ *     que divide um usuário com ele; a matriz densa os cobre pela linha
+ *     do item alterado, mas no top-K essas listas entram em touched.
+ */
+int rating_delta_rows(RatingDelta *changes, const RatingStore *rs, SimilarityMetric metric,
+                      int top_k, const int **rows, const unsigned char **is_row);
+
+/**
+ * Memória de trabalho de uma thread para similarity_item_row()
+ */
+typedef struct {
+    int num_items;
+    PairAccum *accum;
+    float *row;
+} RowWorkspace;
+
+int row_workspace_init(RowWorkspace *ws, int num_items);
+void row_workspace_free(RowWorkspace *ws);
+
+/**
+ * Calcula em ws->row[j] a similaridade de `item` com todos os itens j
+ * (ws->row[item] fica 0), igual a cosine_similarity(item, j)
+ */
+void similarity_item_row(const RatingStore *rs, int item, RowWorkspace *ws);
+
+#endif
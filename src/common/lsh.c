@@ -0,0 +1,226 @@
+/**
+ * LSH - assinaturas MinHash/SimHash por faixa e pares candidatos
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include "lsh.h"
+
+typedef struct {
+    uint64_t key;
+    int item;
+} BucketEntry;
+
+/**
+ * Finalizador do splitmix64: espalha bem entradas consecutivas
+ */
+static uint64_t mix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+/**
+ * Hash do usuário pela função `function` (índice global bands * rows)
+ */
+static uint64_t user_hash(int function, int user) {
+    return mix64(((uint64_t)(uint32_t)function << 32) | (uint32_t)user);
+}
+
+/**
+ * Chave da faixa `band` de item: MinHash combina os `rows` mínimos;
+ * SimHash junta os `rows` bits de sinal das projeções
+ */
+static uint64_t band_key(const RatingStore *rs, const LshParams *params, int band, int item,
+                         uint64_t *mins, double *proj) {
+    int rows = params->rows;
+    int k0 = rs->item_ptr[item];
+    int k1 = rs->item_ptr[item + 1];
+    uint64_t key = 0;
+
+    if (params->scheme == LSH_MINHASH) {
+        for (int r = 0; r < rows; r++) {
+            mins[r] = UINT64_MAX;
+        }
+        for (int k = k0; k < k1; k++) {
+            for (int r = 0; r < rows; r++) {
+                uint64_t h = user_hash(band * rows + r, rs->item_users[k]);
+                if (h < mins[r]) mins[r] = h;
+            }
+        }
+        for (int r = 0; r < rows; r++) {
+            key = mix64(key ^ mins[r]);
+        }
+    } else {
+        // Um hash de 64 bits por usuário dá os sinais (±1) dos `rows` hiperplanos
+        for (int r = 0; r < rows; r++) {
+            proj[r] = 0.0;
+        }
+        for (int k = k0; k < k1; k++) {
+            uint64_t signs = user_hash(band, rs->item_users[k]);
+            double rating = rs->item_ratings[k];
+            for (int r = 0; r < rows; r++) {
+                proj[r] += (signs >> r) & 1 ? rating : -rating;
+            }
+        }
+        for (int r = 0; r < rows; r++) {
+            key = (key << 1) | (proj[r] > 0.0);
+        }
+    }
+    return key;
+}
+
+static int compare_entries(const void *a, const void *b) {
+    const BucketEntry *ea = (const BucketEntry *)a;
+    const BucketEntry *eb = (const BucketEntry *)b;
+    if (ea->key != eb->key) return ea->key < eb->key ? -1 : 1;
+    return ea->item - eb->item;
+}
+
+static int compare_pairs(const void *a, const void *b) {
+    uint64_t pa = *(const uint64_t *)a;
+    uint64_t pb = *(const uint64_t *)b;
+    return pa < pb ? -1 : (pa > pb);
+}
+
+/**
+ * Acrescenta o par (i, j), i < j, codificado como i << 32 | j
+ */
+static int push_pair(uint64_t **pairs, size_t *count, size_t *capacity, int i, int j) {
+    if (*count == *capacity) {
+        size_t grown = *capacity > 0 ? *capacity * 2 : 4096;
+        uint64_t *larger = realloc(*pairs, grown * sizeof(uint64_t));
+        if (!larger) {
+            return -1;
+        }
+        *pairs = larger;
+        *capacity = grown;
+    }
+    (*pairs)[(*count)++] = ((uint64_t)(uint32_t)i << 32) | (uint32_t)j;
+    return 0;
+}
+
+int lsh_candidates_build(const RatingStore *rs, const LshParams *params, LshCandidates *out) {
+    int n = rs->num_items;
+    memset(out, 0, sizeof(*out));
+    out->num_items = n;
+
+    BucketEntry *entries = malloc((n > 0 ? n : 1) * sizeof(BucketEntry));
+    uint64_t *mins = malloc(params->rows * sizeof(uint64_t));
+    double *proj = malloc(params->rows * sizeof(double));
+    out->ptr = calloc(n + 1, sizeof(int));
+    uint64_t *pairs = NULL;
+    size_t count = 0;
+    size_t capacity = 0;
+    int status = 0;
+    if (!entries || !mins || !proj || !out->ptr) {
+        status = -1;
+    }
+
+    for (int band = 0; band < params->bands && status == 0; band++) {
+        int active = 0;
+        for (int i = 0; i < n; i++) {
+            if (rs->item_ptr[i + 1] > rs->item_ptr[i]) {
+                entries[active].key = band_key(rs, params, band, i, mins, proj);
+                entries[active].item = i;
+                active++;
+            }
+        }
+        qsort(entries, active, sizeof(BucketEntry), compare_entries);
+
+        // Cada bucket (chave igual) tem os itens em ordem crescente
+        for (int start = 0; start < active && status == 0; ) {
+            int end = start + 1;
+            while (end < active && entries[end].key == entries[start].key) end++;
+            for (int a = start; a < end && status == 0; a++) {
+                for (int b = a + 1; b < end; b++) {
+                    if (push_pair(&pairs, &count, &capacity, entries[a].item, entries[b].item) != 0) {
+                        status = -1;
+                        break;
+                    }
+                }
+            }
+            start = end;
+        }
+    }
+
+    if (status == 0) {
+        qsort(pairs, count, sizeof(uint64_t), compare_pairs);
+        size_t unique = 0;
+        for (size_t p = 0; p < count; p++) {
+            if (unique == 0 || pairs[p] != pairs[unique - 1]) {
+                pairs[unique++] = pairs[p];
+            }
+        }
+
+        out->items = unique <= INT_MAX ? malloc((unique > 0 ? unique : 1) * sizeof(int)) : NULL;
+        if (!out->items) {
+            status = -1;
+        } else {
+            for (size_t p = 0; p < unique; p++) {
+                out->ptr[(pairs[p] >> 32) + 1]++;
+                out->items[p] = (int)(pairs[p] & 0xFFFFFFFFu);
+            }
+            for (int i = 0; i < n; i++) {
+                out->ptr[i + 1] += out->ptr[i];
+            }
+            out->num_pairs = (long long)unique;
+        }
+    }
+
+    free(entries);
+    free(mins);
+    free(proj);
+    free(pairs);
+    if (status != 0) {
+        fprintf(stderr, "Erro: memória insuficiente para os candidatos LSH\n");
+        lsh_candidates_free(out);
+    }
+    return status;
+}
+
+void lsh_candidates_free(LshCandidates *cand) {
+    free(cand->ptr);
+    free(cand->items);
+    memset(cand, 0, sizeof(*cand));
+}
+
+int lsh_first_candidate(const LshCandidates *cand, int item, int first) {
+    int lo = cand->ptr[item];
+    int hi = cand->ptr[item + 1];
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (cand->items[mid] < first) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+void lsh_print_summary(const LshCandidates *cand, const LshParams *params, double seconds,
+                       FILE *out) {
+    double total = (double)cand->num_items * (cand->num_items - 1) / 2.0;
+    fprintf(out, "Candidatos LSH (%s, %d faixas x %d): %lld pares (%.2f%% de todos) em %.4f s\n",
+            lsh_scheme_name(params->scheme), params->bands, params->rows, cand->num_pairs,
+            total > 0 ? 100.0 * cand->num_pairs / total : 0.0, seconds);
+
+    // Cada par candidato conta para os dois itens
+    double per_item = cand->num_items > 0 ? 2.0 * cand->num_pairs / cand->num_items : 0.0;
+    if (cand->num_items > 1 && per_item < LSH_MIN_CANDIDATES) {
+        fprintf(out, "Aviso: só %.1f candidatos por item em média; o recall dos vizinhos "
+                "deve ser muito baixo (aumente --lsh-bands ou reduza --lsh-rows)\n", per_item);
+    }
+}
+
+const char *lsh_scheme_name(LshScheme scheme) {
+    switch (scheme) {
+        case LSH_SIMHASH: return "simhash";
+        default: return "minhash";
+    }
+}
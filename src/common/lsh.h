@@ -0,0 +1,75 @@
+/**
+ * Geração aproximada de pares candidatos com LSH (--engine=lsh)
+ *
+ * Cada item recebe uma assinatura de bands * rows valores calculada a
+ * partir dos seus avaliadores (coluna CSC):
+ *   - MinHash: mínimos de funções hash sobre o conjunto de usuários
+ *     (aproxima a similaridade de Jaccard dos conjuntos);
+ *   - SimHash: sinais das projeções das notas em hiperplanos aleatórios
+ *     de ±1 (aproxima o ângulo, ou seja, o próprio cosseno).
+ * A assinatura é cortada em `bands` faixas de `rows` valores; itens com a
+ * mesma faixa caem no mesmo bucket e só os pares que dividem algum bucket
+ * têm a similaridade exata calculada. Mais faixas aumentam o recall; mais
+ * linhas por faixa reduzem os candidatos.
+ */
+
+#ifndef LSH_H
+#define LSH_H
+
+#include <stdio.h>
+#include "ratings.h"
+
+typedef enum {
+    LSH_MINHASH,
+    LSH_SIMHASH
+} LshScheme;
+
+// SimHash 32 x 4 por padrão: nas avaliações esparsas o Jaccard entre os
+// conjuntos de avaliadores é quase sempre ~0, e o MinHash deixa de fora
+// até os vizinhos mais próximos
+#define LSH_DEFAULT_SCHEME LSH_SIMHASH
+#define LSH_DEFAULT_BANDS 32
+#define LSH_DEFAULT_ROWS 4
+#define LSH_MAX_ROWS 64  // bits de uma faixa SimHash numa palavra de 64 bits
+#define LSH_MIN_CANDIDATES 10  // média de candidatos por item abaixo da qual o resumo avisa
+
+typedef struct {
+    LshScheme scheme;
+    int bands;
+    int rows;             // valores (MinHash) ou bits (SimHash) por faixa
+} LshParams;
+
+/**
+ * Pares candidatos em CSR: candidatos j > i de cada item i, crescentes e
+ * sem repetição
+ */
+typedef struct {
+    int num_items;
+    int *ptr;             // num_items + 1
+    int *items;           // ptr[num_items]
+    long long num_pairs;
+} LshCandidates;
+
+/**
+ * Assinaturas e buckets de todos os itens de rs (precisa da visão CSC).
+ * Itens sem avaliações não geram candidatos.
+ */
+int lsh_candidates_build(const RatingStore *rs, const LshParams *params, LshCandidates *out);
+
+void lsh_candidates_free(LshCandidates *cand);
+
+/**
+ * Posição do primeiro candidato de item com índice >= first
+ */
+int lsh_first_candidate(const LshCandidates *cand, int item, int first);
+
+/**
+ * Linha de resumo: assinatura, faixas e fração dos pares que viraram
+ * candidatos, com um aviso se sobram menos de LSH_MIN_CANDIDATES por item
+ */
+void lsh_print_summary(const LshCandidates *cand, const LshParams *params, double seconds,
+                       FILE *out);
+
+const char *lsh_scheme_name(LshScheme scheme);
+
+#endif
@@ -0,0 +1,99 @@
+/**
+ * Métricas de similaridade - médias e visão centrada das avaliações
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "metric.h"
+
+int metric_means(const RatingStore *rs, float *user_mean, float *item_mean) {
+    double *item_sum = calloc(rs->num_items > 0 ? rs->num_items : 1, sizeof(double));
+    int *item_count = calloc(rs->num_items > 0 ? rs->num_items : 1, sizeof(int));
+    if (!item_sum || !item_count) {
+        fprintf(stderr, "Erro: memória insuficiente para as médias por item\n");
+        free(item_sum);
+        free(item_count);
+        return -1;
+    }
+
+    for (int u = 0; u < rs->num_users; u++) {
+        double sum = 0.0;
+        for (int p = rs->user_ptr[u]; p < rs->user_ptr[u + 1]; p++) {
+            sum += rs->user_ratings[p];
+            item_sum[rs->user_items[p]] += rs->user_ratings[p];
+            item_count[rs->user_items[p]]++;
+        }
+        int count = rs->user_ptr[u + 1] - rs->user_ptr[u];
+        user_mean[u] = count > 0 ? (float)(sum / count) : 0.0f;
+    }
+    for (int i = 0; i < rs->num_items; i++) {
+        item_mean[i] = item_count[i] > 0 ? (float)(item_sum[i] / item_count[i]) : 0.0f;
+    }
+
+    free(item_sum);
+    free(item_count);
+    return 0;
+}
+
+int metric_input_init(MetricInput *in, const RatingStore *rs, SimilarityMetric metric,
+                      const float *user_mean, const float *item_mean) {
+    memset(in, 0, sizeof(*in));
+    in->metric = metric;
+    in->view = *rs;
+    if (metric == METRIC_COSINE) {
+        return 0;
+    }
+
+    int nnz = rs->num_ratings > 0 ? rs->num_ratings : 1;
+    in->user_mean = malloc((rs->num_users > 0 ? rs->num_users : 1) * sizeof(float));
+    in->item_mean = malloc((rs->num_items > 0 ? rs->num_items : 1) * sizeof(float));
+    in->user_values = malloc(nnz * sizeof(float));
+    in->item_values = malloc(nnz * sizeof(float));
+    if (!in->user_mean || !in->item_mean || !in->user_values || !in->item_values) {
+        fprintf(stderr, "Erro: memória insuficiente para a métrica %s\n", metric_name(metric));
+        metric_input_free(in);
+        return -1;
+    }
+
+    if (user_mean && item_mean) {
+        memcpy(in->user_mean, user_mean, rs->num_users * sizeof(float));
+        memcpy(in->item_mean, item_mean, rs->num_items * sizeof(float));
+    } else if (metric_means(rs, in->user_mean, in->item_mean) != 0) {
+        metric_input_free(in);
+        return -1;
+    }
+
+    for (int u = 0; u < rs->num_users; u++) {
+        for (int p = rs->user_ptr[u]; p < rs->user_ptr[u + 1]; p++) {
+            float mean = metric == METRIC_ADJUSTED ? in->user_mean[u] : in->item_mean[rs->user_items[p]];
+            in->user_values[p] = rs->user_ratings[p] - mean;
+        }
+    }
+    for (int i = 0; i < rs->num_items; i++) {
+        for (int k = rs->item_ptr[i]; k < rs->item_ptr[i + 1]; k++) {
+            float mean = metric == METRIC_ADJUSTED ? in->user_mean[rs->item_users[k]] : in->item_mean[i];
+            in->item_values[k] = rs->item_ratings[k] - mean;
+        }
+    }
+
+    in->view.user_ratings = in->user_values;
+    in->view.item_ratings = in->item_values;
+    return 0;
+}
+
+void metric_input_free(MetricInput *in) {
+    free(in->user_mean);
+    free(in->item_mean);
+    free(in->user_values);
+    free(in->item_values);
+    memset(in, 0, sizeof(*in));
+}
+
+const char *metric_name(SimilarityMetric metric) {
+    switch (metric) {
+        case METRIC_ADJUSTED: return "adjusted";
+        case METRIC_PEARSON: return "pearson";
+        default: return "cosine";
+    }
+}
@@ -0,0 +1,51 @@
+/**
+ * Métricas de similaridade entre itens
+ *
+ * Cosseno ajustado e Pearson são o mesmo cosseno sobre os usuários comuns,
+ * aplicado a avaliações centradas: na média do usuário (ajustado) ou na
+ * média do item (Pearson). As médias são calculadas uma vez na carga e os
+ * valores centrados ficam numa visão com os mesmos índices CSR/CSC do
+ * store original, então todos os motores (pares, blocos, SIMD, linha
+ * incremental) calculam qualquer métrica numa passada, ao mesmo custo do
+ * cosseno. O store original continua com as notas brutas para as predições.
+ */
+
+#ifndef METRIC_H
+#define METRIC_H
+
+#include "ratings.h"
+
+typedef enum {
+    METRIC_COSINE = 0,    // notas brutas (original)
+    METRIC_ADJUSTED = 1,  // cosseno ajustado: r_ui - média do usuário u
+    METRIC_PEARSON = 2    // Pearson: r_ui - média do item i
+} SimilarityMetric;
+
+typedef struct {
+    SimilarityMetric metric;
+    RatingStore view;     // índices de rs com os valores centrados
+    float *user_mean;     // num_users
+    float *item_mean;     // num_items
+    float *user_values;   // valores da visão CSR
+    float *item_values;   // valores da visão CSC
+} MetricInput;
+
+/**
+ * Médias por usuário (linhas CSR) e por item (somas por coluna) numa
+ * passada sobre as avaliações; usuários e itens sem avaliação ficam com 0
+ */
+int metric_means(const RatingStore *rs, float *user_mean, float *item_mean);
+
+/**
+ * Monta a visão de `rs` para a métrica. Com METRIC_COSINE a visão é o
+ * próprio rs, sem cópia. user_mean/item_mean podem vir de fora (MPI: um
+ * processo só tem parte das avaliações); NULL calcula a partir de rs.
+ * rs precisa das visões CSR e CSC.
+ */
+int metric_input_init(MetricInput *in, const RatingStore *rs, SimilarityMetric metric,
+                      const float *user_mean, const float *item_mean);
+void metric_input_free(MetricInput *in);
+
+const char *metric_name(SimilarityMetric metric);
+
+#endif
@@ -0,0 +1,472 @@
+/**
+ * Modelo de similaridade persistido - escrita sequencial e abertura via mmap
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "model.h"
+
+#define MODEL_ALIGN 64
+
+static uint64_t align_up(uint64_t offset) {
+    return (offset + MODEL_ALIGN - 1) & ~(uint64_t)(MODEL_ALIGN - 1);
+}
+
+/**
+ * Escreve `bytes` na posição `offset`, preenchendo com zeros a lacuna
+ */
+static int write_section(FILE *file, uint64_t *pos, uint64_t offset,
+                         const void *data, size_t bytes) {
+    static const char zeros[MODEL_ALIGN];
+    while (*pos < offset) {
+        size_t gap = offset - *pos < MODEL_ALIGN ? offset - *pos : MODEL_ALIGN;
+        if (fwrite(zeros, 1, gap, file) != gap) return -1;
+        *pos += gap;
+    }
+    if (bytes > 0 && fwrite(data, 1, bytes, file) != bytes) return -1;
+    *pos += bytes;
+    return 0;
+}
+
+/**
+ * Seção de um dicionário: offsets (uint64[count + 1]) seguidos das chaves
+ */
+static uint64_t key_table_bytes(const IdMap *ids) {
+    return (uint64_t)(ids->count + 1) * sizeof(uint64_t) + ids->offsets[ids->count];
+}
+
+static int write_key_table(FILE *file, uint64_t *pos, uint64_t offset, const IdMap *ids) {
+    if (write_section(file, pos, offset, ids->offsets, (ids->count + 1) * sizeof(uint64_t)) != 0) {
+        return -1;
+    }
+    return write_section(file, pos, *pos, ids->keys, ids->offsets[ids->count]);
+}
+
+/**
+ * Se a seção [offset, offset + bytes) cabe no arquivo (sem estouro)
+ */
+static int section_fits(uint64_t offset, uint64_t bytes, uint64_t file_size) {
+    return offset <= file_size && bytes <= file_size - offset;
+}
+
+/**
+ * Dicionário mapeado: aponta para dentro da seção (somente leitura)
+ */
+static int map_key_table(IdMap *ids, char *base, uint64_t offset, int count, uint64_t file_size) {
+    memset(ids, 0, sizeof(*ids));
+    uint64_t table = (uint64_t)(count + 1) * sizeof(uint64_t);
+    if (offset == 0 || !section_fits(offset, table, file_size)) {
+        return -1;
+    }
+    const uint64_t *offsets = (const uint64_t *)(base + offset);
+    const char *keys = base + offset + table;
+    if (offsets[0] != 0 || !section_fits(offset + table, offsets[count], file_size)) {
+        return -1;
+    }
+    // Chaves em ordem, cada uma terminada em '\0' dentro da seção
+    for (int i = 0; i < count; i++) {
+        if (offsets[i] >= offsets[i + 1] || keys[offsets[i + 1] - 1] != '\0') {
+            return -1;
+        }
+    }
+    ids->count = count;
+    ids->offsets = (uint64_t *)offsets;
+    ids->keys = (char *)keys;
+    return 0;
+}
+
+/**
+ * Confere as dimensões e as seções do cabeçalho contra o tamanho do
+ * arquivo, e os índices que o scoring usa para endereçar vetores
+ * (ponteiros da CSR, itens avaliados, listas de vizinhos). Retorna o
+ * motivo da recusa ou NULL.
+ */
+static const char *model_check(const ModelHeader *header, const char *base) {
+    uint64_t size = header->file_size;
+    uint64_t n = header->num_items;
+    uint64_t nnz = header->num_ratings;
+
+    if (header->num_users < 0 || header->num_items < 0 || header->num_ratings < 0) {
+        return "dimensões negativas";
+    }
+    if (!section_fits(header->item_ids_offset, n * sizeof(int32_t), size) ||
+        !section_fits(header->user_ptr_offset,
+                      ((uint64_t)header->num_users + 1) * sizeof(int32_t), size) ||
+        !section_fits(header->user_items_offset, nnz * sizeof(int32_t), size) ||
+        !section_fits(header->user_ratings_offset, nnz * sizeof(float), size)) {
+        return "seção fora do arquivo";
+    }
+    if (header->kind == MODEL_NEIGHBORS) {
+        if (header->k <= 0 ||
+            !section_fits(header->count_offset, n * sizeof(int32_t), size) ||
+            !section_fits(header->entries_offset, n * header->k * sizeof(ItemSimilarity), size)) {
+            return "listas de vizinhos fora do arquivo";
+        }
+    } else if (header->kind == MODEL_DENSE) {
+        if (header->precision > TRIANGLE_INT8 ||
+            !section_fits(header->triangle_offset,
+                          packed_triangle_bytes(header->num_items, header->precision), size)) {
+            return "triângulo fora do arquivo";
+        }
+    } else {
+        return "tipo de modelo desconhecido";
+    }
+
+    const int32_t *user_ptr = (const int32_t *)(base + header->user_ptr_offset);
+    const int32_t *user_items = (const int32_t *)(base + header->user_items_offset);
+    if (user_ptr[0] != 0 || user_ptr[header->num_users] != header->num_ratings) {
+        return "ponteiros de usuários inconsistentes";
+    }
+    for (int u = 0; u < header->num_users; u++) {
+        if (user_ptr[u] > user_ptr[u + 1]) {
+            return "ponteiros de usuários inconsistentes";
+        }
+    }
+    for (int32_t r = 0; r < header->num_ratings; r++) {
+        if (user_items[r] < 0 || user_items[r] >= header->num_items) {
+            return "item avaliado fora do intervalo";
+        }
+    }
+
+    if (header->kind == MODEL_NEIGHBORS) {
+        const int32_t *count = (const int32_t *)(base + header->count_offset);
+        const ItemSimilarity *entries = (const ItemSimilarity *)(base + header->entries_offset);
+        for (int i = 0; i < header->num_items; i++) {
+            if (count[i] < 0 || count[i] > header->k) {
+                return "lista de vizinhos inconsistente";
+            }
+            const ItemSimilarity *row = entries + (size_t)i * header->k;
+            for (int c = 0; c < count[i]; c++) {
+                if (row[c].item_id < 0 || row[c].item_id >= header->num_items) {
+                    return "vizinho fora do intervalo";
+                }
+            }
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Preenche o cabeçalho e os offsets das seções (todas alinhadas)
+ */
+static void model_layout(ModelHeader *header, int num_users, int num_items, int num_ratings,
+                         int k, float min_similarity, TrianglePrecision precision,
+                         const IdMap *user_ids, const IdMap *item_ids,
+                         const ModelBuildInfo *info) {
+    int n = num_items;
+    memset(header, 0, sizeof(*header));
+
+    memcpy(header->magic, MODEL_MAGIC, sizeof(MODEL_MAGIC));
+    header->version = MODEL_VERSION;
+    header->byte_order = MODEL_BYTE_ORDER;
+    header->kind = k > 0 ? MODEL_NEIGHBORS : MODEL_DENSE;
+    header->num_users = num_users;
+    header->num_items = n;
+    header->num_ratings = num_ratings;
+    header->k = k;
+    header->min_similarity = min_similarity;
+    header->precision = precision;
+    header->metric = info->metric;
+    snprintf(header->engine, sizeof(header->engine), "%s", info->engine);
+    snprintf(header->source, sizeof(header->source), "%s", info->source);
+    header->created_at = (int64_t)time(NULL);
+    header->build_seconds = info->build_seconds;
+
+    uint64_t offset = align_up(sizeof(ModelHeader));
+    header->item_ids_offset = offset;
+    offset = align_up(offset + (uint64_t)n * sizeof(int32_t));
+    header->user_ptr_offset = offset;
+    offset = align_up(offset + (uint64_t)(num_users + 1) * sizeof(int32_t));
+    header->user_items_offset = offset;
+    offset = align_up(offset + (uint64_t)num_ratings * sizeof(int32_t));
+    header->user_ratings_offset = offset;
+    offset = align_up(offset + (uint64_t)num_ratings * sizeof(float));
+    if (k > 0) {
+        header->count_offset = offset;
+        offset = align_up(offset + (uint64_t)n * sizeof(int32_t));
+        header->entries_offset = offset;
+        offset += (uint64_t)n * k * sizeof(ItemSimilarity);
+    } else {
+        header->triangle_offset = offset;
+        offset += packed_triangle_bytes(n, precision);
+    }
+    if (user_ids && item_ids) {
+        header->user_keys_offset = offset = align_up(offset);
+        offset += key_table_bytes(user_ids);
+        header->item_keys_offset = offset = align_up(offset);
+        offset += key_table_bytes(item_ids);
+    }
+    header->file_size = offset;
+}
+
+int model_save(const char *path, const RatingStore *rs, const NeighborIndex *neighbors,
+               const PackedTriangle *triangle, const ModelBuildInfo *info) {
+    int n = rs->num_items;
+    int nnz = rs->num_ratings;
+    ModelHeader header;
+    model_layout(&header, rs->num_users, n, nnz, neighbors ? neighbors->k : 0,
+                 neighbors ? neighbors->min_similarity : 0.0f,
+                 neighbors ? TRIANGLE_FP32 : triangle->precision, rs->user_ids, rs->item_ids,
+                 info);
+
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        fprintf(stderr, "Erro ao criar modelo: %s\n", path);
+        return -1;
+    }
+
+    int32_t *item_ids = malloc((n > 0 ? n : 1) * sizeof(int32_t));
+    if (!item_ids) {
+        fclose(file);
+        return -1;
+    }
+    for (int i = 0; i < n; i++) {
+        item_ids[i] = i;
+    }
+
+    uint64_t pos = 0;
+    int status = write_section(file, &pos, 0, &header, sizeof(header));
+    status |= write_section(file, &pos, header.item_ids_offset, item_ids, n * sizeof(int32_t));
+    status |= write_section(file, &pos, header.user_ptr_offset, rs->user_ptr,
+                            (rs->num_users + 1) * sizeof(int32_t));
+    status |= write_section(file, &pos, header.user_items_offset, rs->user_items,
+                            nnz * sizeof(int32_t));
+    status |= write_section(file, &pos, header.user_ratings_offset, rs->user_ratings,
+                            nnz * sizeof(float));
+    if (neighbors) {
+        status |= write_section(file, &pos, header.count_offset, neighbors->count,
+                                n * sizeof(int32_t));
+        status |= write_section(file, &pos, header.entries_offset, neighbors->entries,
+                                (size_t)n * neighbors->k * sizeof(ItemSimilarity));
+    } else {
+        status |= write_section(file, &pos, header.triangle_offset,
+                                packed_triangle_data(triangle),
+                                packed_triangle_bytes(n, triangle->precision));
+    }
+    if (header.user_keys_offset) {
+        status |= write_key_table(file, &pos, header.user_keys_offset, rs->user_ids);
+        status |= write_key_table(file, &pos, header.item_keys_offset, rs->item_ids);
+    }
+
+    free(item_ids);
+    if (fclose(file) != 0 || status != 0) {
+        fprintf(stderr, "Erro ao gravar modelo: %s\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+int model_writer_open(ModelWriter *writer, const char *path, int num_users, int num_items,
+                      int num_ratings, int k, float min_similarity, const ModelBuildInfo *info) {
+    memset(writer, 0, sizeof(*writer));
+    model_layout(&writer->header, num_users, num_items, num_ratings, k, min_similarity,
+                 TRIANGLE_FP32, NULL, NULL, info);
+
+    writer->file = fopen(path, "wb+");
+    if (!writer->file) {
+        fprintf(stderr, "Erro ao criar modelo: %s\n", path);
+        return -1;
+    }
+
+    // Mapa de IDs: identidade, em pedaços
+    int32_t ids[1024];
+    for (int first = 0; first < num_items; first += 1024) {
+        int count = num_items - first < 1024 ? num_items - first : 1024;
+        for (int i = 0; i < count; i++) {
+            ids[i] = first + i;
+        }
+        model_writer_put(writer, writer->header.item_ids_offset + (uint64_t)first * sizeof(int32_t),
+                         ids, count * sizeof(int32_t));
+    }
+    return writer->failed ? -1 : 0;
+}
+
+int model_writer_put(ModelWriter *writer, uint64_t offset, const void *data, size_t bytes) {
+    if (writer->failed || bytes == 0) {
+        return writer->failed ? -1 : 0;
+    }
+    if (fseeko(writer->file, (off_t)offset, SEEK_SET) != 0 ||
+        fwrite(data, 1, bytes, writer->file) != bytes) {
+        writer->failed = 1;
+        return -1;
+    }
+    return 0;
+}
+
+int model_writer_close(ModelWriter *writer, const char *path, double build_seconds) {
+    int status = writer->failed ? -1 : 0;
+    writer->header.build_seconds = build_seconds;
+
+    // Lacunas de alinhamento e listas nunca escritas ficam zeradas
+    if (status == 0 &&
+        (model_writer_put(writer, 0, &writer->header, sizeof(ModelHeader)) != 0 ||
+         fflush(writer->file) != 0 ||
+         ftruncate(fileno(writer->file), (off_t)writer->header.file_size) != 0)) {
+        status = -1;
+    }
+    if (writer->file && fclose(writer->file) != 0) {
+        status = -1;
+    }
+    if (status != 0) {
+        fprintf(stderr, "Erro ao gravar modelo: %s\n", path);
+    }
+    memset(writer, 0, sizeof(*writer));
+    return status;
+}
+
+int model_open(Model *model, const char *path) {
+    memset(model, 0, sizeof(*model));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Erro ao abrir modelo: %s\n", path);
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ModelHeader)) {
+        fprintf(stderr, "Modelo inválido (tamanho): %s\n", path);
+        close(fd);
+        return -1;
+    }
+
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "Erro no mmap do modelo: %s\n", path);
+        return -1;
+    }
+
+    const ModelHeader *header = (const ModelHeader *)map;
+    if (memcmp(header->magic, MODEL_MAGIC, sizeof(MODEL_MAGIC)) != 0 ||
+        header->byte_order != MODEL_BYTE_ORDER) {
+        fprintf(stderr, "Arquivo não é um modelo (ou ordem de bytes diferente): %s\n", path);
+        munmap(map, st.st_size);
+        return -1;
+    }
+    if (header->version != MODEL_VERSION || header->file_size != (uint64_t)st.st_size) {
+        fprintf(stderr, "Modelo com versão %u não suportada ou truncado: %s\n",
+                header->version, path);
+        munmap(map, st.st_size);
+        return -1;
+    }
+
+    char *base = (char *)map;
+    const char *problem = model_check(header, base);
+    if (problem) {
+        fprintf(stderr, "Modelo inválido (%s): %s\n", problem, path);
+        munmap(map, st.st_size);
+        return -1;
+    }
+
+    model->map = map;
+    model->map_size = st.st_size;
+    model->header = header;
+    model->item_ids = (const int32_t *)(base + header->item_ids_offset);
+
+    // Visões apontam para dentro do mapeamento (somente leitura)
+    model->ratings.num_users = header->num_users;
+    model->ratings.num_items = header->num_items;
+    model->ratings.num_ratings = header->num_ratings;
+    model->ratings.user_ptr = (int *)(base + header->user_ptr_offset);
+    model->ratings.user_items = (int *)(base + header->user_items_offset);
+    model->ratings.user_ratings = (float *)(base + header->user_ratings_offset);
+    if (header->user_keys_offset) {
+        if (map_key_table(&model->user_keys, base, header->user_keys_offset,
+                          header->num_users, header->file_size) != 0 ||
+            map_key_table(&model->item_keys, base, header->item_keys_offset,
+                          header->num_items, header->file_size) != 0) {
+            fprintf(stderr, "Modelo inválido (dicionário de IDs): %s\n", path);
+            munmap(map, st.st_size);
+            memset(model, 0, sizeof(*model));
+            return -1;
+        }
+        model->ratings.user_ids = &model->user_keys;
+        model->ratings.item_ids = &model->item_keys;
+    }
+
+    if (header->kind == MODEL_NEIGHBORS) {
+        model->neighbors.num_items = header->num_items;
+        model->neighbors.k = header->k;
+        model->neighbors.min_similarity = header->min_similarity;
+        model->neighbors.count = (int *)(base + header->count_offset);
+        model->neighbors.entries = (ItemSimilarity *)(base + header->entries_offset);
+    } else {
+        void *values = base + header->triangle_offset;
+        model->triangle.n = header->num_items;
+        model->triangle.precision = (TrianglePrecision)header->precision;
+        switch (model->triangle.precision) {
+            case TRIANGLE_FP16: model->triangle.half = values; break;
+            case TRIANGLE_INT8: model->triangle.quant = values; break;
+            default: model->triangle.values = values; break;
+        }
+    }
+    return 0;
+}
+
+void model_close(Model *model) {
+    if (model->map) {
+        munmap(model->map, model->map_size);
+    }
+    memset(model, 0, sizeof(*model));
+}
+
+void model_print_info(const Model *model, FILE *out) {
+    const ModelHeader *h = model->header;
+    time_t created = (time_t)h->created_at;
+    char when[32];
+    strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", localtime(&created));
+
+    fprintf(out, "Modelo v%u (%s): %d usuários, %d itens, %d avaliações\n",
+            h->version, h->kind == MODEL_NEIGHBORS ? "vizinhos top-K" : "matriz densa",
+            h->num_users, h->num_items, h->num_ratings);
+    if (h->kind == MODEL_NEIGHBORS) {
+        fprintf(out, "  K = %d\n", h->k);
+    } else {
+        fprintf(out, "  Triângulo empacotado em %s (%.1f MB)\n",
+                triangle_precision_name((TrianglePrecision)h->precision),
+                packed_triangle_bytes(h->num_items, (TrianglePrecision)h->precision) / 1e6);
+    }
+    fprintf(out, "  Métrica: %s\n", metric_name((SimilarityMetric)h->metric));
+    if (h->user_keys_offset) {
+        fprintf(out, "  IDs externos remapeados (%.1f KB de chaves)\n",
+                (model->user_keys.offsets[h->num_users] + model->item_keys.offsets[h->num_items]) / 1e3);
+    }
+    fprintf(out, "  Construído em %s a partir de %s (motor %s, %.4f s)\n",
+            when, h->source, h->engine, h->build_seconds);
+}
+
+int model_copy_neighbors(const Model *model, NeighborIndex *idx, int num_items) {
+    const NeighborIndex *src = &model->neighbors;
+    if (neighbor_index_init(idx, num_items, src->k, src->min_similarity) != 0) {
+        return -1;
+    }
+
+    for (int i = 0; i < src->num_items && i < num_items; i++) {
+        memcpy(idx->entries + (size_t)i * src->k, src->entries + (size_t)i * src->k,
+               src->count[i] * sizeof(ItemSimilarity));
+        idx->count[i] = src->count[i];
+    }
+    return 0;
+}
+
+int model_copy_triangle(const Model *model, PackedTriangle *tri, int num_items) {
+    const PackedTriangle *src = &model->triangle;
+    if (packed_triangle_init(tri, num_items) != 0) {
+        return -1;
+    }
+
+    for (int i = 0; i < src->n && i < num_items; i++) {
+        float *row = tri->values + triangle_row_offset(num_items, i);
+        for (int j = i + 1; j < src->n && j < num_items; j++) {
+            row[j - i - 1] = packed_triangle_get(src, i, j);
+        }
+    }
+    return 0;
+}
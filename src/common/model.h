@@ -0,0 +1,142 @@
+/**
+ * Modelo de similaridade persistido em disco
+ *
+ * O modo "build" grava, após o cálculo, um arquivo binário versionado com
+ * as listas de vizinhos (ou o triângulo da matriz densa), o mapa de IDs de itens, o
+ * histórico dos usuários (CSR), os dicionários de IDs externos (--remap-ids)
+ * e metadados do build. O modo "serve" abre
+ * esse arquivo com mmap, sem nenhum parsing: as estruturas apontam direto
+ * para as páginas mapeadas, que são compartilhadas entre processos.
+ */
+
+#ifndef MODEL_H
+#define MODEL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "ratings.h"
+#include "neighbors.h"
+#include "triangle.h"
+#include "metric.h"
+#include "idmap.h"
+
+#define MODEL_MAGIC "RECMODL"
+#define MODEL_VERSION 4
+#define MODEL_BYTE_ORDER 0x01020304u
+
+typedef enum {
+    MODEL_DENSE = 0,      // triângulo superior empacotado (triangle.h)
+    MODEL_NEIGHBORS = 1   // listas top-K por item
+} ModelKind;
+
+/**
+ * Cabeçalho no início do arquivo; todas as seções são alinhadas a 64 bytes
+ * e localizadas pelos offsets abaixo
+ */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t kind;
+    int32_t num_users;
+    int32_t num_items;
+    int32_t num_ratings;
+    int32_t k;
+    float min_similarity;
+    uint32_t precision;           // TrianglePrecision (MODEL_DENSE)
+    uint32_t metric;              // SimilarityMetric da similaridade gravada
+
+    // Metadados do build
+    char engine[16];
+    char source[256];
+    int64_t created_at;
+    double build_seconds;
+
+    uint64_t item_ids_offset;     // int32[num_items]: ID externo de cada item
+    uint64_t user_ptr_offset;     // int32[num_users + 1]
+    uint64_t user_items_offset;   // int32[num_ratings]
+    uint64_t user_ratings_offset; // float[num_ratings]
+    uint64_t count_offset;        // int32[num_items] (MODEL_NEIGHBORS)
+    uint64_t entries_offset;      // ItemSimilarity[num_items * k] (MODEL_NEIGHBORS)
+    uint64_t triangle_offset;     // num_items * (num_items - 1) / 2 valores (MODEL_DENSE)
+    uint64_t user_keys_offset;    // uint64[num_users + 1] + chaves (idmap.h); 0: IDs = índices
+    uint64_t item_keys_offset;    // uint64[num_items + 1] + chaves; 0: IDs = índices
+    uint64_t file_size;
+} ModelHeader;
+
+typedef struct {
+    const char *engine;
+    const char *source;
+    double build_seconds;
+    SimilarityMetric metric;
+} ModelBuildInfo;
+
+/**
+ * Modelo aberto (somente leitura). ratings só tem a visão CSR; neighbors
+ * e triangle apontam para dentro do mapeamento.
+ */
+typedef struct {
+    void *map;
+    size_t map_size;
+    const ModelHeader *header;
+    const int32_t *item_ids;
+    IdMap user_keys;              // dicionários mapeados (ratings.user_ids/item_ids)
+    IdMap item_keys;
+    RatingStore ratings;
+    NeighborIndex neighbors;
+    PackedTriangle triangle;
+} Model;
+
+/**
+ * Grava o modelo. Com neighbors != NULL grava as listas top-K (já
+ * finalizadas); senão grava o triângulo na precisão em que está. Os
+ * dicionários de IDs de rs, se houver, vão junto.
+ */
+int model_save(const char *path, const RatingStore *rs, const NeighborIndex *neighbors,
+               const PackedTriangle *triangle, const ModelBuildInfo *info);
+
+/**
+ * Gravação de um modelo de vizinhos por partes, para quem não tem as
+ * avaliações nem as listas inteiras em memória (outofcore.h): as
+ * dimensões fixam os offsets no header e cada trecho é escrito na sua
+ * posição, em qualquer ordem. open já grava o mapa de IDs.
+ */
+typedef struct {
+    FILE *file;
+    ModelHeader header;
+    int failed;
+} ModelWriter;
+
+int model_writer_open(ModelWriter *writer, const char *path, int num_users, int num_items,
+                      int num_ratings, int k, float min_similarity, const ModelBuildInfo *info);
+
+/**
+ * Escreve `bytes` em `offset` (header.*_offset + posição dentro da seção)
+ */
+int model_writer_put(ModelWriter *writer, uint64_t offset, const void *data, size_t bytes);
+
+/**
+ * Grava o cabeçalho com o tempo final do build e fecha o arquivo
+ */
+int model_writer_close(ModelWriter *writer, const char *path, double build_seconds);
+
+int model_open(Model *model, const char *path);
+void model_close(Model *model);
+
+void model_print_info(const Model *model, FILE *out);
+
+/**
+ * Copiam a similaridade do modelo para estruturas mutáveis (por exemplo,
+ * para uma atualização incremental). num_items pode ser maior que o do
+ * modelo: os itens novos começam sem vizinhos / com similaridade zero. As
+ * listas copiadas já estão ordenadas (não são heaps): só ofereça vizinhos
+ * a linhas esvaziadas antes com neighbor_index_reset_row().
+ */
+int model_copy_neighbors(const Model *model, NeighborIndex *idx, int num_items);
+
+/**
+ * O triângulo copiado é sempre FP32 (valores FP16/INT8 são expandidos)
+ */
+int model_copy_triangle(const Model *model, PackedTriangle *tri, int num_items);
+
+#endif
@@ -0,0 +1,129 @@
+/**
+ * Índice esparso de vizinhos top-K - heaps limitados por linha
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include "neighbors.h"
+
+int neighbor_index_init(NeighborIndex *idx, int num_items, int k, float min_similarity) {
+    memset(idx, 0, sizeof(*idx));
+    idx->num_items = num_items;
+    idx->k = k;
+    idx->min_similarity = min_similarity;
+    idx->count = calloc(num_items > 0 ? num_items : 1, sizeof(int));
+    idx->entries = malloc((size_t)(num_items > 0 ? num_items : 1) * k * sizeof(ItemSimilarity));
+    idx->floor = malloc((num_items > 0 ? num_items : 1) * sizeof(float));
+    idx->locks = calloc(num_items > 0 ? num_items : 1, 1);
+    if (!idx->count || !idx->entries || !idx->floor || !idx->locks) {
+        fprintf(stderr, "Erro: memória insuficiente para o índice de vizinhos (K=%d)\n", k);
+        neighbor_index_free(idx);
+        return -1;
+    }
+
+    for (int i = 0; i < num_items; i++) {
+        idx->floor[i] = -FLT_MAX;
+    }
+    return 0;
+}
+
+void neighbor_index_free(NeighborIndex *idx) {
+    free(idx->count);
+    free(idx->entries);
+    free(idx->floor);
+    free(idx->locks);
+    memset(idx, 0, sizeof(*idx));
+}
+
+void neighbor_index_offer(NeighborIndex *idx, int item, int neighbor, float sim) {
+    // Similaridade 0 não contribui para nenhuma predição
+    if (sim == 0.0 || sim < idx->min_similarity || idx->k <= 0) {
+        return;
+    }
+
+    // Descarte rápido sem trava: o piso da linha só aumenta
+    float floor;
+    __atomic_load(&idx->floor[item], &floor, __ATOMIC_RELAXED);
+    if (sim < floor) {
+        return;
+    }
+
+    while (__atomic_test_and_set(&idx->locks[item], __ATOMIC_ACQUIRE)) {
+        // espera ativa: seções críticas têm O(log K) passos
+    }
+
+    ItemSimilarity *heap = idx->entries + (size_t)item * idx->k;
+    ItemSimilarity candidate = { neighbor, sim };
+    topk_push(heap, &idx->count[item], idx->k, candidate);
+
+    if (idx->count[item] == idx->k) {
+        __atomic_store(&idx->floor[item], &heap[0].similarity, __ATOMIC_RELAXED);
+    }
+
+    __atomic_clear(&idx->locks[item], __ATOMIC_RELEASE);
+}
+
+void neighbor_index_reset_row(NeighborIndex *idx, int item) {
+    idx->count[item] = 0;
+    idx->floor[item] = -FLT_MAX;
+}
+
+void neighbor_index_row_sink(int item, int first, const float *sims, int count, void *ctx) {
+    NeighborIndex *idx = (NeighborIndex *)ctx;
+
+    for (int k = 0; k < count; k++) {
+        neighbor_index_offer(idx, item, first + k, sims[k]);
+        neighbor_index_offer(idx, first + k, item, sims[k]);
+    }
+}
+
+void neighbor_index_merge(NeighborIndex *idx, const int *count, const ItemSimilarity *entries) {
+    for (int i = 0; i < idx->num_items; i++) {
+        const ItemSimilarity *row = entries + (size_t)i * idx->k;
+        for (int n = 0; n < count[i]; n++) {
+            neighbor_index_offer(idx, i, row[n].item_id, row[n].similarity);
+        }
+    }
+}
+
+void neighbor_index_finalize(NeighborIndex *idx) {
+    for (int i = 0; i < idx->num_items; i++) {
+        topk_sort(idx->entries + (size_t)i * idx->k, idx->count[i]);
+    }
+}
+
+void neighbor_index_predict(const NeighborIndex *idx, const RatingStore *rs, int user,
+                            float *predictions, float *similarity_sum) {
+    memset(predictions, 0, idx->num_items * sizeof(float));
+    memset(similarity_sum, 0, idx->num_items * sizeof(float));
+
+    if (user < 0 || user >= rs->num_users) {
+        return;
+    }
+
+    // Espalha cada item avaliado sobre os seus vizinhos
+    for (int p = rs->user_ptr[user]; p < rs->user_ptr[user + 1]; p++) {
+        int rated_item = rs->user_items[p];
+        float user_rating = rs->user_ratings[p];
+        const ItemSimilarity *row = idx->entries + (size_t)rated_item * idx->k;
+
+        for (int n = 0; n < idx->count[rated_item]; n++) {
+            predictions[row[n].item_id] += row[n].similarity * user_rating;
+            similarity_sum[row[n].item_id] += fabs(row[n].similarity);
+        }
+    }
+
+    for (int item = 0; item < idx->num_items; item++) {
+        if (similarity_sum[item] > 0) {
+            predictions[item] /= similarity_sum[item];
+        }
+    }
+
+    // Itens já avaliados não são recomendados
+    for (int p = rs->user_ptr[user]; p < rs->user_ptr[user + 1]; p++) {
+        predictions[rs->user_items[p]] = 0.0;
+    }
+}
@@ -0,0 +1,64 @@
+/**
+ * Índice esparso de vizinhos: apenas os K itens mais similares por item
+ *
+ * Substitui a matriz densa similarity_matrix[MAX_ITEMS][MAX_ITEMS]
+ * (O(n²) de memória) por listas de tamanho K (O(nK)). Cada linha é mantida
+ * como um heap mínimo limitado (topk.h) durante o cálculo da similaridade.
+ */
+
+#ifndef NEIGHBORS_H
+#define NEIGHBORS_H
+
+#include "ratings.h"
+#include "topk.h"
+
+typedef struct {
+    int num_items;
+    int k;
+    float min_similarity;    // pares abaixo do limiar são descartados
+    int *count;              // vizinhos guardados por item
+    ItemSimilarity *entries; // linha do item i em entries[i * k ..]
+    float *floor;            // pior similaridade da linha quando cheia
+    unsigned char *locks;    // trava por linha (spinlock)
+} NeighborIndex;
+
+int neighbor_index_init(NeighborIndex *idx, int num_items, int k, float min_similarity);
+void neighbor_index_free(NeighborIndex *idx);
+
+/**
+ * Oferece `neighbor` como vizinho de `item`. Seguro entre threads:
+ * cada linha é protegida por sua própria trava.
+ */
+void neighbor_index_offer(NeighborIndex *idx, int item, int neighbor, float sim);
+
+/**
+ * Esvazia a linha de `item` para que seus vizinhos sejam recalculados
+ */
+void neighbor_index_reset_row(NeighborIndex *idx, int item);
+
+/**
+ * Oferece o par (item, first + k) às duas linhas; mesma assinatura de
+ * SimilarityRowSink (ctx = NeighborIndex *)
+ */
+void neighbor_index_row_sink(int item, int first, const float *sims, int count, void *ctx);
+
+/**
+ * Oferece a `idx` todas as linhas de outro índice com o mesmo K
+ * (count[i] entradas em entries[i * K ..]), por exemplo vindas de outro processo
+ */
+void neighbor_index_merge(NeighborIndex *idx, const int *count, const ItemSimilarity *entries);
+
+/**
+ * Ordena cada linha por similaridade decrescente (empate: menor item_id)
+ */
+void neighbor_index_finalize(NeighborIndex *idx);
+
+/**
+ * Predições do usuário usando apenas as listas de vizinhos dos itens que
+ * ele avaliou: O(|avaliados| * K). predictions e similarity_sum têm
+ * num_items posições; itens já avaliados ficam com predição 0.
+ */
+void neighbor_index_predict(const NeighborIndex *idx, const RatingStore *rs, int user,
+                            float *predictions, float *similarity_sum);
+
+#endif
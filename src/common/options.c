@@ -0,0 +1,218 @@
+/**
+ * Opções de linha de comando comuns a todas as versões
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include "options.h"
+
+void options_init(Options *opts) {
+    opts->engine = ENGINE_PAIRS;
+    opts->block_size = 0;
+    opts->metric = METRIC_COSINE;
+    opts->lsh.scheme = LSH_DEFAULT_SCHEME;
+    opts->lsh.bands = LSH_DEFAULT_BANDS;
+    opts->lsh.rows = LSH_DEFAULT_ROWS;
+    opts->top_k = 0;
+    opts->min_similarity = -FLT_MAX;
+    opts->save_model_path = NULL;
+    opts->load_threads = 0;
+    opts->serve = 0;
+    opts->update_path = NULL;
+    opts->batch_users = NULL;
+    opts->batch_output = "recomendacoes.csv";
+    opts->top_n = 10;
+    opts->batch_shards = 0;
+    opts->precision = TRIANGLE_FP32;
+    opts->simd = SIMD_AUTO;
+    opts->accuracy = 0;
+    opts->memory_budget = 0;
+    opts->spill_dir = NULL;
+    opts->remap_ids = 0;
+}
+
+/**
+ * Se arg for "--nome=valor", retorna o ponteiro para valor
+ */
+static const char *option_value(const char *arg, const char *name) {
+    size_t len = strlen(name);
+    if (strncmp(arg, name, len) == 0 && arg[len] == '=') {
+        return arg + len + 1;
+    }
+    return NULL;
+}
+
+int options_parse(Options *opts, int argc, char *argv[], int first) {
+    for (int i = first; i < argc; i++) {
+        const char *value;
+
+        if ((value = option_value(argv[i], "--engine")) != NULL) {
+            if (strcmp(value, "pairs") == 0) {
+                opts->engine = ENGINE_PAIRS;
+            } else if (strcmp(value, "blocked") == 0) {
+                opts->engine = ENGINE_BLOCKED;
+            } else if (strcmp(value, "lsh") == 0) {
+                opts->engine = ENGINE_LSH;
+            } else if (strcmp(value, "allpairs") == 0) {
+                opts->engine = ENGINE_ALLPAIRS;
+            } else {
+                fprintf(stderr, "Motor desconhecido: %s\n", value);
+                return -1;
+            }
+        } else if ((value = option_value(argv[i], "--block")) != NULL) {
+            opts->block_size = atoi(value);
+            if (opts->block_size <= 0) {
+                fprintf(stderr, "Tamanho de bloco inválido: %s\n", value);
+                return -1;
+            }
+        } else if ((value = option_value(argv[i], "--lsh")) != NULL) {
+            if (strcmp(value, "minhash") == 0) {
+                opts->lsh.scheme = LSH_MINHASH;
+            } else if (strcmp(value, "simhash") == 0) {
+                opts->lsh.scheme = LSH_SIMHASH;
+            } else {
+                fprintf(stderr, "Assinatura LSH desconhecida: %s\n", value);
+                return -1;
+            }
+        } else if ((value = option_value(argv[i], "--lsh-bands")) != NULL) {
+            opts->lsh.bands = atoi(value);
+            if (opts->lsh.bands <= 0) {
+                fprintf(stderr, "Número de faixas inválido: %s\n", value);
+                return -1;
+            }
+        } else if ((value = option_value(argv[i], "--lsh-rows")) != NULL) {
+            opts->lsh.rows = atoi(value);
+            if (opts->lsh.rows <= 0 || opts->lsh.rows > LSH_MAX_ROWS) {
+                fprintf(stderr, "Linhas por faixa inválidas (1 a %d): %s\n", LSH_MAX_ROWS, value);
+                return -1;
+            }
+        } else if ((value = option_value(argv[i], "--metric")) != NULL) {
+            if (strcmp(value, "cosine") == 0) {
+                opts->metric = METRIC_COSINE;
+            } else if (strcmp(value, "adjusted") == 0) {
+                opts->metric = METRIC_ADJUSTED;
+            } else if (strcmp(value, "pearson") == 0) {
+                opts->metric = METRIC_PEARSON;
+            } else {
+                fprintf(stderr, "Métrica desconhecida: %s\n", value);
+                return -1;
+            }
+        } else if ((value = option_value(argv[i], "--topk")) != NULL) {
+            opts->top_k = atoi(value);
+            if (opts->top_k <= 0) {
+                fprintf(stderr, "K inválido: %s\n", value);
+                return -1;
+            }
+        } else if ((value = option_value(argv[i], "--min-sim")) != NULL) {
+            opts->min_similarity = atof(value);
+        } else if ((value = option_value(argv[i], "--save-model")) != NULL) {
+            opts->save_model_path = value;
+        } else if ((value = option_value(argv[i], "--load-threads")) != NULL) {
+            opts->load_threads = atoi(value);
+            if (opts->load_threads <= 0) {
+                fprintf(stderr, "Número de threads de leitura inválido: %s\n", value);
+                return -1;
+            }
+        } else if ((value = option_value(argv[i], "--update")) != NULL) {
+            opts->update_path = value;
+        } else if ((value = option_value(argv[i], "--users")) != NULL) {
+            opts->batch_users = value;
+        } else if ((value = option_value(argv[i], "--output")) != NULL) {
+            opts->batch_output = value;
+        } else if ((value = option_value(argv[i], "--top-n")) != NULL) {
+            opts->top_n = atoi(value);
+            if (opts->top_n <= 0) {
+                fprintf(stderr, "N inválido: %s\n", value);
+                return -1;
+            }
+        } else if ((value = option_value(argv[i], "--precision")) != NULL) {
+            if (strcmp(value, "fp32") == 0) {
+                opts->precision = TRIANGLE_FP32;
+            } else if (strcmp(value, "fp16") == 0) {
+                opts->precision = TRIANGLE_FP16;
+            } else if (strcmp(value, "int8") == 0) {
+                opts->precision = TRIANGLE_INT8;
+            } else {
+                fprintf(stderr, "Precisão desconhecida: %s\n", value);
+                return -1;
+            }
+        } else if ((value = option_value(argv[i], "--simd")) != NULL) {
+            if (strcmp(value, "auto") == 0) {
+                opts->simd = SIMD_AUTO;
+            } else if (strcmp(value, "scalar") == 0) {
+                opts->simd = SIMD_SCALAR;
+            } else if (strcmp(value, "avx2") == 0) {
+                opts->simd = SIMD_AVX2;
+            } else if (strcmp(value, "avx512") == 0) {
+                opts->simd = SIMD_AVX512;
+            } else {
+                fprintf(stderr, "Kernel SIMD desconhecido: %s\n", value);
+                return -1;
+            }
+        } else if ((value = option_value(argv[i], "--memory-budget")) != NULL) {
+            double megabytes = atof(value);
+            if (megabytes <= 0) {
+                fprintf(stderr, "Orçamento de memória inválido: %s\n", value);
+                return -1;
+            }
+            opts->memory_budget = (size_t)(megabytes * 1e6);
+        } else if ((value = option_value(argv[i], "--spill-dir")) != NULL) {
+            opts->spill_dir = value;
+        } else if (strcmp(argv[i], "--serve") == 0) {
+            opts->serve = 1;
+        } else if (strcmp(argv[i], "--accuracy") == 0) {
+            opts->accuracy = 1;
+        } else if (strcmp(argv[i], "--shards") == 0) {
+            opts->batch_shards = 1;
+        } else if (strcmp(argv[i], "--remap-ids") == 0) {
+            opts->remap_ids = 1;
+        } else {
+            fprintf(stderr, "Opção desconhecida: %s\n", argv[i]);
+            return -1;
+        }
+    }
+
+    // O build fora da memória ordena e indexa pelos próprios IDs numéricos
+    if (opts->remap_ids && opts->memory_budget > 0) {
+        fprintf(stderr, "--remap-ids não se aplica ao build fora da memória (--memory-budget)\n");
+        return -1;
+    }
+    return 0;
+}
+
+void options_print_usage(FILE *out) {
+    fprintf(out, "Opções:\n");
+    fprintf(out, "  --engine=pairs|blocked|lsh|allpairs  motor da matriz de similaridade (padrão: pairs)\n");
+    fprintf(out, "  --block=N               lado do ladrilho do motor em blocos\n");
+    fprintf(out, "  --lsh=minhash|simhash   assinaturas do motor lsh (padrão: %s)\n",
+            lsh_scheme_name(LSH_DEFAULT_SCHEME));
+    fprintf(out, "  --lsh-bands=B           faixas do LSH (padrão: %d)\n", LSH_DEFAULT_BANDS);
+    fprintf(out, "  --lsh-rows=R            valores por faixa do LSH (padrão: %d)\n", LSH_DEFAULT_ROWS);
+    fprintf(out, "  --metric=cosine|adjusted|pearson  similaridade entre itens (padrão: cosine)\n");
+    fprintf(out, "  --topk=K                guarda só os K vizinhos mais similares por item\n");
+    fprintf(out, "  --min-sim=S             descarta vizinhos com similaridade < S (com --topk)\n");
+    fprintf(out, "  --save-model=ARQ        grava o modelo calculado (modo build)\n");
+    fprintf(out, "  --load-threads=N        threads para ler o arquivo de avaliações\n");
+    fprintf(out, "  --serve                 <arquivo> é um modelo salvo; só gera recomendações\n");
+    fprintf(out, "  --update=DELTA          aplica o delta de avaliações ao modelo <arquivo>\n");
+    fprintf(out, "  --users=all|ARQ|IDS     recomendações em lote para os usuários dados\n");
+    fprintf(out, "  --output=ARQ            CSV do lote (padrão: recomendacoes.csv)\n");
+    fprintf(out, "  --top-n=N               recomendações por usuário no lote (padrão: 10)\n");
+    fprintf(out, "  --shards                MPI: cada processo grava o lote em ARQ.<rank>\n");
+    fprintf(out, "  --precision=fp32|fp16|int8  precisão da matriz densa (padrão: fp32)\n");
+    fprintf(out, "  --simd=auto|scalar|avx2|avx512  kernels de similaridade (padrão: auto)\n");
+    fprintf(out, "  --accuracy              compara a similaridade com a referência float64\n");
+    fprintf(out, "  --memory-budget=MB      build top-K fora da memória (exige --topk e --save-model)\n");
+    fprintf(out, "  --spill-dir=DIR         temporários do build fora da memória (padrão: $TMPDIR ou /tmp)\n");
+    fprintf(out, "  --remap-ids             IDs de usuário/item quaisquer (texto ou números grandes)\n");
+}
+
+const char *options_engine_name(SimilarityEngine engine) {
+    switch (engine) {
+        case ENGINE_BLOCKED: return "blocked";
+        case ENGINE_LSH: return "lsh";
+        case ENGINE_ALLPAIRS: return "allpairs";
+        default: return "pairs";
+    }
+}
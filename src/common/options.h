@@ -0,0 +1,61 @@
+/**
+ * Opções de linha de comando comuns a todas as versões
+ *
+ * As opções vêm depois dos argumentos posicionais de cada executável:
+ *   recommender_seq <arquivo> [opções]
+ *   recommender_omp <arquivo> <num_threads> [opções]
+ *
+ * Com --serve ou --update, <arquivo> é um modelo gravado antes com --save-model.
+ */
+
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <stdio.h>
+#include "triangle.h"
+#include "simd.h"
+#include "metric.h"
+#include "lsh.h"
+
+typedef enum {
+    ENGINE_PAIRS,    // uma chamada de cosine_similarity() por par (original)
+    ENGINE_BLOCKED,  // produto esparso em ladrilhos (blocked.h)
+    ENGINE_LSH,      // aproximado: só os pares candidatos do LSH (lsh.h)
+    ENGINE_ALLPAIRS  // exato: só os pares com avaliador comum (allpairs.h)
+} SimilarityEngine;
+
+typedef struct {
+    SimilarityEngine engine;
+    int block_size;        // <= 0: tamanho padrão para a L2
+    SimilarityMetric metric;  // cosseno, cosseno ajustado ou Pearson (metric.h)
+    LshParams lsh;         // assinaturas e faixas do motor lsh
+    int top_k;             // > 0: índice de vizinhos top-K em vez da matriz densa
+    float min_similarity;  // limiar opcional do índice de vizinhos
+    const char *save_model_path;  // modo build: grava o modelo (model.h)
+    int load_threads;      // threads do leitor de avaliações (0: padrão da versão)
+    int serve;             // modo serve: o arquivo posicional é um modelo salvo
+    const char *update_path;  // delta de avaliações aplicado ao modelo (incremental.h)
+    const char *batch_users;  // lote de recomendações: "all", arquivo ou lista de IDs
+    const char *batch_output; // arquivo CSV do lote (recommend.h)
+    int top_n;             // recomendações por usuário no lote
+    int batch_shards;      // MPI: um CSV por processo (ARQ.<rank>) em vez de um só
+    TrianglePrecision precision;  // precisão da matriz densa depois do cálculo
+    int accuracy;          // relatório de precisão contra a referência float64 (accuracy.h)
+    SimdLevel simd;        // kernels vetoriais (simd.h); SIMD_AUTO: o melhor da CPU
+    size_t memory_budget;  // > 0: build fora da memória com este orçamento em bytes (outofcore.h)
+    const char *spill_dir; // arquivos temporários do build fora da memória
+    int remap_ids;         // IDs externos quaisquer, com índices densos (idmap.h)
+} Options;
+
+void options_init(Options *opts);
+
+/**
+ * Interpreta argv[first..argc-1]; retorna -1 em opção inválida
+ */
+int options_parse(Options *opts, int argc, char *argv[], int first);
+
+void options_print_usage(FILE *out);
+
+const char *options_engine_name(SimilarityEngine engine);
+
+#endif
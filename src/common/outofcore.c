@@ -0,0 +1,1058 @@
+/**
+ * Build fora da memória - ordenação externa, blocos de grupos de itens e
+ * listas top-K parciais em disco
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "outofcore.h"
+#include "parser.h"
+#include "ratings_binary.h"
+#include "timer.h"
+
+#define MIN_RUN_RATINGS 4096       // menor pedaço/buffer de leitura, qualquer que seja o orçamento
+#define PARSE_BYTES_PER_RATING 36  // triplas do leitor (com folga de crescimento e cópia) + RunEntry
+#define TEXT_BYTES_PER_RATING 6    // menor linha "u i r\n": limita as triplas de uma janela
+#define BLOCK_BYTES_PER_RATING 40  // triplas, CSR/CSC e usuários de um bloco
+#define SECTION_BUFFER 65536
+
+/**
+ * Ordena um pedaço por (usuário, item); seq desempata na ordem do arquivo
+ */
+typedef struct {
+    int user_id;
+    int item_id;
+    int seq;
+    float rating;
+} RunEntry;
+
+typedef struct {
+    const OutOfCoreParams *params;
+    OutOfCoreStats *stats;
+    char dir[PATH_MAX - 512];  // diretório temporário (mkdtemp); sobra espaço para os nomes
+    size_t used;               // memória contabilizada agora
+    int num_users;
+    int num_items;
+    int num_runs;              // pedaços da ordenação em andamento
+    int *item_count;           // num_items: avaliações por item
+    int *item_ptr;             // num_items + 1: posição de cada coluna no arquivo CSC
+    float *user_mean;          // métricas centradas
+    float *item_mean;
+    int num_groups;
+    int *group_start;          // num_groups + 1
+    int *user_slot;            // num_users: índice local do usuário no bloco (-1 fora dele)
+} OutOfCore;
+
+/**
+ * Leitura bufferizada de um arquivo de triplas
+ */
+typedef struct {
+    FILE *file;
+    Rating *buffer;
+    size_t capacity;
+    size_t count;
+    size_t pos;
+} RunReader;
+
+/**
+ * Trecho de uma seção do modelo escrito em sequência
+ */
+typedef struct {
+    ModelWriter *writer;
+    uint64_t offset;
+    char data[SECTION_BUFFER];
+    size_t used;
+} SectionBuffer;
+
+static void account(OutOfCore *ooc, size_t bytes) {
+    ooc->used += bytes;
+    if (ooc->used > ooc->stats->peak_bytes) {
+        ooc->stats->peak_bytes = ooc->used;
+    }
+}
+
+static void release(OutOfCore *ooc, size_t bytes) {
+    ooc->used -= bytes < ooc->used ? bytes : ooc->used;
+}
+
+/**
+ * Menor orçamento possível: os pedaços da leitura do texto e o buffer de
+ * cópia das seções CSR não ficam abaixo de MIN_RUN_RATINGS triplas
+ */
+static size_t minimum_budget(void) {
+    size_t parse = (size_t)MIN_RUN_RATINGS * PARSE_BYTES_PER_RATING;
+    size_t copy = (size_t)MIN_RUN_RATINGS * sizeof(Rating) + 3 * sizeof(SectionBuffer);
+    return parse > copy ? parse : copy;
+}
+
+static void temp_path(const OutOfCore *ooc, char *path, const char *name, int index) {
+    if (index >= 0) {
+        snprintf(path, PATH_MAX, "%s/%s.%d", ooc->dir, name, index);
+    } else {
+        snprintf(path, PATH_MAX, "%s/%s", ooc->dir, name);
+    }
+}
+
+/**
+ * Apaga o diretório temporário e tudo o que sobrou nele
+ */
+static void remove_temp_dir(const OutOfCore *ooc) {
+    DIR *dir = opendir(ooc->dir);
+    if (dir) {
+        struct dirent *entry;
+        char path[PATH_MAX];
+        while ((entry = readdir(dir)) != NULL) {
+            if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0) {
+                snprintf(path, sizeof(path), "%s/%s", ooc->dir, entry->d_name);
+                unlink(path);
+            }
+        }
+        closedir(dir);
+    }
+    rmdir(ooc->dir);
+}
+
+static int compare_run_entry(const void *a, const void *b) {
+    const RunEntry *ea = (const RunEntry *)a;
+    const RunEntry *eb = (const RunEntry *)b;
+    if (ea->user_id != eb->user_id) return ea->user_id < eb->user_id ? -1 : 1;
+    if (ea->item_id != eb->item_id) return ea->item_id < eb->item_id ? -1 : 1;
+    return ea->seq < eb->seq ? -1 : (ea->seq > eb->seq);
+}
+
+static int by_user(const Rating *a, const Rating *b) {
+    if (a->user_id != b->user_id) return a->user_id < b->user_id ? -1 : 1;
+    return a->item_id < b->item_id ? -1 : (a->item_id > b->item_id);
+}
+
+static int by_item(const Rating *a, const Rating *b) {
+    if (a->item_id != b->item_id) return a->item_id < b->item_id ? -1 : 1;
+    return a->user_id < b->user_id ? -1 : (a->user_id > b->user_id);
+}
+
+static int compare_by_item(const void *a, const void *b) {
+    return by_item((const Rating *)a, (const Rating *)b);
+}
+
+static int compare_int(const void *a, const void *b) {
+    int x = *(const int *)a;
+    int y = *(const int *)b;
+    return x < y ? -1 : (x > y);
+}
+
+static int write_run(OutOfCore *ooc, const char *name, const Rating *triples, size_t count) {
+    char path[PATH_MAX];
+    temp_path(ooc, path, name, ooc->num_runs);
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        fprintf(stderr, "Erro ao criar arquivo temporário: %s\n", path);
+        return -1;
+    }
+    int status = fwrite(triples, sizeof(Rating), count, file) == count ? 0 : -1;
+    if (fclose(file) != 0 || status != 0) {
+        fprintf(stderr, "Erro ao gravar arquivo temporário: %s\n", path);
+        return -1;
+    }
+    ooc->num_runs++;
+    ooc->stats->num_runs++;
+    return 0;
+}
+
+/**
+ * Um pedaço do texto: ordena por (usuário, item), mantém a última
+ * ocorrência de cada par (notas <= 0 inclusive: removem uma nota anterior
+ * de outro pedaço) e grava como "run.N"
+ */
+static int sort_text_run(OutOfCore *ooc, Rating *triples, int count) {
+    RunEntry *entries = malloc((count > 0 ? count : 1) * sizeof(RunEntry));
+    if (!entries) {
+        fprintf(stderr, "Erro: memória insuficiente para ordenar %d avaliações\n", count);
+        return -1;
+    }
+    for (int k = 0; k < count; k++) {
+        entries[k].user_id = triples[k].user_id;
+        entries[k].item_id = triples[k].item_id;
+        entries[k].seq = k;
+        entries[k].rating = triples[k].rating;
+        if (triples[k].user_id >= ooc->num_users) ooc->num_users = triples[k].user_id + 1;
+        if (triples[k].item_id >= ooc->num_items) ooc->num_items = triples[k].item_id + 1;
+    }
+    qsort(entries, count, sizeof(RunEntry), compare_run_entry);
+
+    int unique = 0;
+    for (int k = 0; k < count; k++) {
+        if (k + 1 < count && entries[k + 1].user_id == entries[k].user_id &&
+            entries[k + 1].item_id == entries[k].item_id) {
+            continue;
+        }
+        triples[unique].user_id = entries[k].user_id;
+        triples[unique].item_id = entries[k].item_id;
+        triples[unique].rating = entries[k].rating;
+        unique++;
+    }
+    free(entries);
+    return write_run(ooc, "run", triples, unique);
+}
+
+/**
+ * Etapa 1: lê o texto em janelas alinhadas a quebras de linha, cada uma
+ * com no máximo o número de triplas que o orçamento permite ordenar
+ */
+static int read_text_runs(OutOfCore *ooc, const char *filename) {
+    if (ratings_binary_detect(filename)) {
+        fprintf(stderr, "Erro: o build fora da memória lê só o formato texto: %s\n", filename);
+        return -1;
+    }
+
+    int fd = open(filename, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        fprintf(stderr, "Erro ao abrir arquivo: %s\n", filename);
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    size_t size = st.st_size;
+    const char *data = NULL;
+    if (size > 0) {
+        data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            fprintf(stderr, "Erro no mmap de %s\n", filename);
+            close(fd);
+            return -1;
+        }
+        madvise((void *)data, size, MADV_SEQUENTIAL);
+    }
+    close(fd);
+
+    size_t run_ratings = ooc->params->memory_budget / PARSE_BYTES_PER_RATING;
+    if (run_ratings < MIN_RUN_RATINGS) run_ratings = MIN_RUN_RATINGS;
+    if (run_ratings > INT_MAX / 2) run_ratings = INT_MAX / 2;
+    size_t window = run_ratings * TEXT_BYTES_PER_RATING;
+
+    int status = 0;
+    int skipped_total = 0;
+    int malformed = 0;
+    for (size_t begin = 0; begin < size && status == 0 && !malformed; ) {
+        size_t end = size - begin > window ? begin + window : size;
+        if (end < size) {
+            const char *newline = memchr(data + end, '\n', size - end);
+            end = newline ? (size_t)(newline - data) + 1 : size;
+        }
+
+        Rating *triples;
+        int count, skipped;
+        if (parse_ratings_buffer(data + begin, end - begin, 0, ooc->params->num_workers,
+                                 &triples, &count, &skipped, &malformed) != 0) {
+            fprintf(stderr, "Erro: memória insuficiente ao ler %s\n", filename);
+            status = -1;
+            break;
+        }
+        account(ooc, (size_t)count * PARSE_BYTES_PER_RATING);
+        skipped_total += skipped;
+        if (count > 0) {
+            status = sort_text_run(ooc, triples, count);
+        }
+        release(ooc, (size_t)count * PARSE_BYTES_PER_RATING);
+        free(triples);
+        begin = end;
+    }
+
+    if (data) {
+        munmap((void *)data, size);
+    }
+    if (malformed) {
+        fprintf(stderr, "Aviso: leitura interrompida em token inválido em %s\n", filename);
+    }
+    if (skipped_total > 0) {
+        fprintf(stderr, "Aviso: %d avaliações com ID fora do limite ignoradas\n", skipped_total);
+    }
+    return status;
+}
+
+static const Rating *run_reader_peek(RunReader *reader) {
+    if (reader->pos == reader->count) {
+        reader->count = fread(reader->buffer, sizeof(Rating), reader->capacity, reader->file);
+        reader->pos = 0;
+        if (reader->count == 0) {
+            return NULL;
+        }
+    }
+    return &reader->buffer[reader->pos];
+}
+
+/**
+ * Fusão dos pedaços name.0 .. name.(num_runs - 1) na ordem de `before`.
+ * Com a mesma chave em mais de um pedaço, vence o último (o mais recente
+ * no arquivo); notas <= 0 não são emitidas. Os pedaços são apagados.
+ */
+static int merge_runs(OutOfCore *ooc, const char *name,
+                      int (*before)(const Rating *, const Rating *),
+                      int (*emit)(const Rating *, void *), void *ctx) {
+    int num_runs = ooc->num_runs;
+    size_t capacity = ooc->params->memory_budget / 2 / sizeof(Rating) / (num_runs > 0 ? num_runs : 1);
+    if (capacity < 1024) capacity = 1024;
+
+    RunReader *readers = calloc(num_runs > 0 ? num_runs : 1, sizeof(RunReader));
+    Rating *buffers = malloc((size_t)(num_runs > 0 ? num_runs : 1) * capacity * sizeof(Rating));
+    if (!readers || !buffers) {
+        fprintf(stderr, "Erro: memória insuficiente para a fusão de %d pedaços\n", num_runs);
+        free(readers);
+        free(buffers);
+        return -1;
+    }
+    account(ooc, (size_t)num_runs * capacity * sizeof(Rating));
+
+    int status = 0;
+    char path[PATH_MAX];
+    for (int r = 0; r < num_runs; r++) {
+        temp_path(ooc, path, name, r);
+        readers[r].file = fopen(path, "rb");
+        readers[r].buffer = buffers + (size_t)r * capacity;
+        readers[r].capacity = capacity;
+        if (!readers[r].file) {
+            fprintf(stderr, "Erro ao abrir arquivo temporário: %s\n", path);
+            status = -1;
+        }
+    }
+
+    while (status == 0) {
+        int best = -1;
+        for (int r = 0; r < num_runs; r++) {
+            const Rating *head = run_reader_peek(&readers[r]);
+            if (head && (best < 0 || before(head, &readers[best].buffer[readers[best].pos]) < 0)) {
+                best = r;
+            }
+        }
+        if (best < 0) {
+            break;
+        }
+
+        // Consome a chave em todos os pedaços; o de maior índice é o mais recente
+        Rating winner = readers[best].buffer[readers[best].pos];
+        for (int r = best; r < num_runs; r++) {
+            const Rating *head = run_reader_peek(&readers[r]);
+            if (head && before(head, &winner) == 0) {
+                winner = *head;
+                readers[r].pos++;
+            }
+        }
+        if (winner.rating > 0 && emit(&winner, ctx) != 0) {
+            status = -1;
+        }
+    }
+
+    for (int r = 0; r < num_runs; r++) {
+        if (readers[r].file) fclose(readers[r].file);
+        temp_path(ooc, path, name, r);
+        unlink(path);
+    }
+    release(ooc, (size_t)num_runs * capacity * sizeof(Rating));
+    free(readers);
+    free(buffers);
+    ooc->num_runs = 0;
+    return status;
+}
+
+/**
+ * Etapa 2a: avaliações finais em ordem de usuário ("csr"), contagens por
+ * item e somas das médias (mesma ordem de soma de metric_means())
+ */
+typedef struct {
+    OutOfCore *ooc;
+    FILE *file;
+    long long count;
+    double *item_sum;
+    int user;                  // usuário da linha em andamento
+    double user_sum;
+    int user_count;
+} CsrSink;
+
+static void finish_user(CsrSink *sink) {
+    if (sink->user >= 0 && sink->ooc->user_mean) {
+        sink->ooc->user_mean[sink->user] = (float)(sink->user_sum / sink->user_count);
+    }
+}
+
+static int emit_csr(const Rating *rating, void *ctx) {
+    CsrSink *sink = (CsrSink *)ctx;
+    if (rating->user_id != sink->user) {
+        finish_user(sink);
+        sink->user = rating->user_id;
+        sink->user_sum = 0.0;
+        sink->user_count = 0;
+    }
+    sink->user_sum += rating->rating;
+    sink->user_count++;
+    sink->ooc->item_count[rating->item_id]++;
+    if (sink->item_sum) {
+        sink->item_sum[rating->item_id] += rating->rating;
+    }
+    sink->count++;
+    return fwrite(rating, sizeof(Rating), 1, sink->file) == 1 ? 0 : -1;
+}
+
+static int merge_user_order(OutOfCore *ooc) {
+    int n = ooc->num_items;
+    int centered = ooc->params->metric != METRIC_COSINE;
+    char path[PATH_MAX];
+    temp_path(ooc, path, "csr", -1);
+
+    CsrSink sink;
+    memset(&sink, 0, sizeof(sink));
+    sink.ooc = ooc;
+    sink.user = -1;
+    sink.file = fopen(path, "wb");
+    ooc->item_count = calloc(n > 0 ? n : 1, sizeof(int));
+    if (centered) {
+        sink.item_sum = calloc(n > 0 ? n : 1, sizeof(double));
+        ooc->user_mean = calloc(ooc->num_users > 0 ? ooc->num_users : 1, sizeof(float));
+        ooc->item_mean = calloc(n > 0 ? n : 1, sizeof(float));
+    }
+    if (!sink.file || !ooc->item_count ||
+        (centered && (!sink.item_sum || !ooc->user_mean || !ooc->item_mean))) {
+        fprintf(stderr, "Erro: memória insuficiente para as contagens por item\n");
+        if (sink.file) fclose(sink.file);
+        free(sink.item_sum);
+        return -1;
+    }
+    size_t per_item = sizeof(int) + (centered ? sizeof(double) + sizeof(float) : 0);
+    account(ooc, (size_t)n * per_item + (centered ? (size_t)ooc->num_users * sizeof(float) : 0));
+
+    int status = merge_runs(ooc, "run", by_user, emit_csr, &sink);
+    finish_user(&sink);
+    if (fclose(sink.file) != 0) {
+        status = -1;
+    }
+    if (status == 0 && sink.count > INT_MAX) {
+        fprintf(stderr, "Erro: %lld avaliações excedem o limite do modelo\n", sink.count);
+        status = -1;
+    }
+    ooc->stats->num_ratings = (int)sink.count;
+
+    if (centered) {
+        for (int i = 0; i < n; i++) {
+            ooc->item_mean[i] = ooc->item_count[i] > 0
+                ? (float)(sink.item_sum[i] / ooc->item_count[i]) : 0.0f;
+        }
+        free(sink.item_sum);
+        release(ooc, (size_t)n * sizeof(double));
+    }
+    return status;
+}
+
+static int section_put(SectionBuffer *section, const void *data, size_t bytes) {
+    if (section->used + bytes > sizeof(section->data)) {
+        if (model_writer_put(section->writer, section->offset, section->data, section->used) != 0) {
+            return -1;
+        }
+        section->offset += section->used;
+        section->used = 0;
+    }
+    memcpy(section->data + section->used, data, bytes);
+    section->used += bytes;
+    return 0;
+}
+
+static int section_flush(SectionBuffer *section) {
+    int status = model_writer_put(section->writer, section->offset, section->data, section->used);
+    section->offset += section->used;
+    section->used = 0;
+    return status;
+}
+
+/**
+ * Etapa 2b: copia "csr" para as seções CSR do modelo e, ao mesmo tempo,
+ * forma os pedaços em ordem de item ("crun.N")
+ */
+static int write_csr_sections(OutOfCore *ooc, ModelWriter *writer) {
+    char path[PATH_MAX];
+    temp_path(ooc, path, "csr", -1);
+    FILE *file = fopen(path, "rb");
+
+    size_t run_ratings = ooc->params->memory_budget / 2 / sizeof(Rating);
+    if (run_ratings < MIN_RUN_RATINGS) run_ratings = MIN_RUN_RATINGS;
+    Rating *run = malloc(run_ratings * sizeof(Rating));
+    SectionBuffer *sections = malloc(3 * sizeof(SectionBuffer));
+    if (!file || !run || !sections) {
+        fprintf(stderr, "Erro: memória insuficiente para copiar as avaliações\n");
+        if (file) fclose(file);
+        free(run);
+        free(sections);
+        return -1;
+    }
+    account(ooc, run_ratings * sizeof(Rating) + 3 * sizeof(SectionBuffer));
+
+    SectionBuffer *ptr = &sections[0];
+    SectionBuffer *items = &sections[1];
+    SectionBuffer *values = &sections[2];
+    ptr->writer = items->writer = values->writer = writer;
+    ptr->used = items->used = values->used = 0;
+    ptr->offset = writer->header.user_ptr_offset;
+    items->offset = writer->header.user_items_offset;
+    values->offset = writer->header.user_ratings_offset;
+
+    int status = 0;
+    int next_user = 0;        // próxima posição de user_ptr a escrever
+    int32_t position = 0;
+    size_t filled = 0;
+    Rating rating;
+    while (status == 0 && fread(&rating, sizeof(Rating), 1, file) == 1) {
+        while (next_user <= rating.user_id) {
+            status |= section_put(ptr, &position, sizeof(int32_t));
+            next_user++;
+        }
+        status |= section_put(items, &rating.item_id, sizeof(int32_t));
+        status |= section_put(values, &rating.rating, sizeof(float));
+        position++;
+
+        run[filled++] = rating;
+        if (filled == run_ratings) {
+            qsort(run, filled, sizeof(Rating), compare_by_item);
+            status |= write_run(ooc, "crun", run, filled);
+            filled = 0;
+        }
+    }
+    while (status == 0 && next_user <= ooc->num_users) {
+        status |= section_put(ptr, &position, sizeof(int32_t));
+        next_user++;
+    }
+    if (status == 0 && filled > 0) {
+        qsort(run, filled, sizeof(Rating), compare_by_item);
+        status = write_run(ooc, "crun", run, filled);
+    }
+    status |= section_flush(ptr) | section_flush(items) | section_flush(values);
+
+    fclose(file);
+    unlink(path);
+    release(ooc, run_ratings * sizeof(Rating) + 3 * sizeof(SectionBuffer));
+    free(run);
+    free(sections);
+    return status;
+}
+
+static int emit_csc(const Rating *rating, void *ctx) {
+    return fwrite(rating, sizeof(Rating), 1, (FILE *)ctx) == 1 ? 0 : -1;
+}
+
+/**
+ * Etapa 2c: arquivo "csc" com as colunas em ordem de item e de usuário
+ */
+static int merge_item_order(OutOfCore *ooc) {
+    int n = ooc->num_items;
+    char path[PATH_MAX];
+    temp_path(ooc, path, "csc", -1);
+    FILE *file = fopen(path, "wb");
+    ooc->item_ptr = malloc((n + 1) * sizeof(int));
+    if (!file || !ooc->item_ptr) {
+        fprintf(stderr, "Erro ao criar arquivo temporário: %s\n", path);
+        if (file) fclose(file);
+        return -1;
+    }
+    account(ooc, (n + 1) * sizeof(int));
+
+    ooc->item_ptr[0] = 0;
+    for (int i = 0; i < n; i++) {
+        ooc->item_ptr[i + 1] = ooc->item_ptr[i] + ooc->item_count[i];
+    }
+
+    int status = merge_runs(ooc, "crun", by_item, emit_csc, file);
+    if (fclose(file) != 0) {
+        status = -1;
+    }
+    return status;
+}
+
+/**
+ * Grupos contíguos de itens: cada grupo usa no máximo metade do que sobra
+ * do orçamento, para que os dois grupos de um bloco caibam juntos
+ */
+static int plan_groups(OutOfCore *ooc) {
+    const OutOfCoreParams *params = ooc->params;
+    int n = ooc->num_items;
+    int workers = params->num_workers;
+
+    // Por item de um bloco: duas listas top-K, workspaces e ponteiros locais
+    size_t item_bytes = 2 * ((size_t)params->top_k * sizeof(ItemSimilarity) + 2 * sizeof(int) +
+                             sizeof(float) + 1) +
+                        (size_t)workers * (sizeof(PairAccum) + 1 + sizeof(int) + sizeof(float)) +
+                        2 * sizeof(int);
+    size_t fixed = ooc->used + (size_t)(n + 1) * sizeof(int) + (size_t)ooc->num_users * sizeof(int);
+    if (fixed + 2 * (item_bytes + BLOCK_BYTES_PER_RATING) > params->memory_budget) {
+        fprintf(stderr, "Erro: orçamento de %.1f MB menor que os vetores por item e usuário "
+                "(%.1f MB)\n", params->memory_budget / 1e6, fixed / 1e6);
+        return -1;
+    }
+    size_t limit = (params->memory_budget - fixed) / 2;
+
+    ooc->group_start = malloc((n + 1) * sizeof(int));
+    ooc->user_slot = malloc((ooc->num_users > 0 ? ooc->num_users : 1) * sizeof(int));
+    if (!ooc->group_start || !ooc->user_slot) {
+        fprintf(stderr, "Erro: memória insuficiente para os grupos de itens\n");
+        return -1;
+    }
+    account(ooc, (n + 1) * sizeof(int) + (size_t)ooc->num_users * sizeof(int));
+    for (int u = 0; u < ooc->num_users; u++) {
+        ooc->user_slot[u] = -1;
+    }
+
+    int groups = 0;
+    size_t bytes = 0;
+    for (int i = 0; i < n; i++) {
+        size_t cost = item_bytes + (size_t)ooc->item_count[i] * BLOCK_BYTES_PER_RATING;
+        if (cost > limit) {
+            // Uma coluna não é dividida: o bloco desse item passa do orçamento
+            fprintf(stderr, "Aviso: item %d com %d avaliações excede sozinho o orçamento "
+                    "de um grupo (%.1f MB)\n", i, ooc->item_count[i], limit / 1e6);
+        }
+        if (i == 0 || bytes + cost > limit) {
+            ooc->group_start[groups++] = i;
+            bytes = 0;
+        }
+        bytes += cost;
+    }
+    ooc->group_start[groups] = n;
+    ooc->num_groups = groups;
+    ooc->stats->num_groups = groups;
+    return 0;
+}
+
+/**
+ * Triplas (usuário, item global, nota) das colunas first .. last - 1
+ */
+static Rating *load_columns(OutOfCore *ooc, FILE *csc, int first, int last, int *count) {
+    int begin = ooc->item_ptr[first];
+    *count = ooc->item_ptr[last] - begin;
+    Rating *triples = malloc((*count > 0 ? *count : 1) * sizeof(Rating));
+    if (!triples) {
+        fprintf(stderr, "Erro: memória insuficiente para %d avaliações de um grupo\n", *count);
+        return NULL;
+    }
+    if (fseeko(csc, (off_t)begin * sizeof(Rating), SEEK_SET) != 0 ||
+        fread(triples, sizeof(Rating), *count, csc) != (size_t)*count) {
+        fprintf(stderr, "Erro ao ler o arquivo temporário das colunas\n");
+        free(triples);
+        return NULL;
+    }
+    return triples;
+}
+
+/**
+ * Store local do bloco: usuários renumerados em ordem crescente (a soma
+ * de cada par percorre os avaliadores comuns na mesma ordem do build em
+ * memória) e itens do grupo p em 0 .. rows - 1, do grupo q depois. As
+ * colunas do arquivo já vêm ordenadas por usuário, então a CSC é copiada
+ * e a CSR sai por transposição, sem ordenar as avaliações.
+ */
+static int build_block_store(OutOfCore *ooc, const Rating *a, int na, int row_begin, int rows,
+                             const Rating *b, int nb, int col_begin, int cols,
+                             RatingStore *local, int **users_out) {
+    int total = na + nb;
+    int items = rows + cols;
+    int *slot = ooc->user_slot;
+    int *users = malloc((total > 0 ? total : 1) * sizeof(int));
+    memset(local, 0, sizeof(*local));
+    local->num_items = items;
+    local->num_ratings = total;
+    local->item_ptr = calloc(items + 1, sizeof(int));
+    local->item_users = malloc((total > 0 ? total : 1) * sizeof(int));
+    local->item_ratings = malloc((total > 0 ? total : 1) * sizeof(float));
+    local->user_items = malloc((total > 0 ? total : 1) * sizeof(int));
+    local->user_ratings = malloc((total > 0 ? total : 1) * sizeof(float));
+    if (!users || !local->item_ptr || !local->item_users || !local->item_ratings ||
+        !local->user_items || !local->user_ratings) {
+        free(users);
+        rating_store_free(local);
+        return -1;
+    }
+
+    // Usuários distintos do bloco, numerados depois em ordem crescente
+    int num_users = 0;
+    for (int k = 0; k < total; k++) {
+        int user = k < na ? a[k].user_id : b[k - na].user_id;
+        if (slot[user] < 0) {
+            slot[user] = 0;
+            users[num_users++] = user;
+        }
+    }
+    qsort(users, num_users, sizeof(int), compare_int);
+    for (int u = 0; u < num_users; u++) {
+        slot[users[u]] = u;
+    }
+
+    local->num_users = num_users;
+    local->user_ptr = calloc(num_users + 1, sizeof(int));
+    int *fill = malloc((num_users > 0 ? num_users : 1) * sizeof(int));
+    if (!local->user_ptr || !fill) {
+        for (int u = 0; u < num_users; u++) slot[users[u]] = -1;
+        free(fill);
+        free(users);
+        rating_store_free(local);
+        return -1;
+    }
+
+    for (int k = 0; k < total; k++) {
+        const Rating *src = k < na ? &a[k] : &b[k - na];
+        int li = k < na ? src->item_id - row_begin : rows + src->item_id - col_begin;
+        int u = slot[src->user_id];
+        local->item_ptr[li + 1]++;
+        local->user_ptr[u + 1]++;
+        local->item_users[k] = u;
+        local->item_ratings[k] = src->rating;
+    }
+    for (int li = 0; li < items; li++) {
+        local->item_ptr[li + 1] += local->item_ptr[li];
+    }
+    for (int u = 0; u < num_users; u++) {
+        local->user_ptr[u + 1] += local->user_ptr[u];
+        slot[users[u]] = -1;
+    }
+
+    // Percorrer as colunas em ordem deixa cada linha ordenada por item
+    memcpy(fill, local->user_ptr, num_users * sizeof(int));
+    for (int li = 0; li < items; li++) {
+        for (int k = local->item_ptr[li]; k < local->item_ptr[li + 1]; k++) {
+            int pos = fill[local->item_users[k]]++;
+            local->user_items[pos] = li;
+            local->user_ratings[pos] = local->item_ratings[k];
+        }
+    }
+    free(fill);
+
+    // Mesma centragem de metric_input_init(), com as médias globais
+    SimilarityMetric metric = ooc->params->metric;
+    if (metric != METRIC_COSINE) {
+        for (int u = 0; u < local->num_users; u++) {
+            for (int p = local->user_ptr[u]; p < local->user_ptr[u + 1]; p++) {
+                int li = local->user_items[p];
+                int item = li < rows ? row_begin + li : col_begin + li - rows;
+                float mean = metric == METRIC_ADJUSTED ? ooc->user_mean[users[u]] : ooc->item_mean[item];
+                local->user_ratings[p] = local->user_ratings[p] - mean;
+            }
+        }
+        for (int li = 0; li < local->num_items; li++) {
+            int item = li < rows ? row_begin + li : col_begin + li - rows;
+            for (int k = local->item_ptr[li]; k < local->item_ptr[li + 1]; k++) {
+                float mean = metric == METRIC_ADJUSTED ? ooc->user_mean[users[local->item_users[k]]]
+                                                       : ooc->item_mean[item];
+                local->item_ratings[k] = local->item_ratings[k] - mean;
+            }
+        }
+    }
+    *users_out = users;
+    return 0;
+}
+
+void outofcore_block_rows(const OutOfCoreBlock *block, int begin, int end, int worker) {
+    AllPairsWorkspace *ws = &block->workspaces[worker];
+    int first = block->cols > 0 ? block->rows : 0;
+    int last = block->rows + block->cols;
+
+    for (int i = begin; i < end; i++) {
+        int count = allpairs_row(block->local, i, first, last, ws);
+        for (int c = 0; c < count; c++) {
+            int j = ws->items[c];
+            if (block->cols > 0) {
+                neighbor_index_offer(block->row_lists, i, block->col_begin + j - block->rows, ws->sims[c]);
+                neighbor_index_offer(block->col_lists, j - block->rows, block->row_begin + i, ws->sims[c]);
+            } else {
+                neighbor_index_offer(block->row_lists, i, block->row_begin + j, ws->sims[c]);
+                neighbor_index_offer(block->row_lists, j, block->row_begin + i, ws->sims[c]);
+            }
+        }
+    }
+}
+
+/**
+ * Grava as listas parciais não vazias do grupo q em "spill.q":
+ * (item, count, count entradas)
+ */
+static int spill_lists(OutOfCore *ooc, const NeighborIndex *lists, int group) {
+    char path[PATH_MAX];
+    temp_path(ooc, path, "spill", group);
+    FILE *file = fopen(path, "ab");
+    if (!file) {
+        fprintf(stderr, "Erro ao criar arquivo temporário: %s\n", path);
+        return -1;
+    }
+
+    int status = 0;
+    int first = ooc->group_start[group];
+    for (int r = 0; r < lists->num_items && status == 0; r++) {
+        int count = lists->count[r];
+        if (count == 0) {
+            continue;
+        }
+        int item = first + r;
+        if (fwrite(&item, sizeof(int), 1, file) != 1 || fwrite(&count, sizeof(int), 1, file) != 1 ||
+            fwrite(lists->entries + (size_t)r * lists->k, sizeof(ItemSimilarity), count, file) !=
+                (size_t)count) {
+            status = -1;
+        }
+        ooc->stats->spilled_lists++;
+        ooc->stats->spill_bytes += 2 * sizeof(int) + (long long)count * sizeof(ItemSimilarity);
+    }
+    if (fclose(file) != 0 || status != 0) {
+        fprintf(stderr, "Erro ao gravar arquivo temporário: %s\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Oferece às listas do grupo as parciais gravadas pelos blocos anteriores
+ */
+static int merge_spilled(OutOfCore *ooc, NeighborIndex *lists, int group) {
+    char path[PATH_MAX];
+    temp_path(ooc, path, "spill", group);
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return 0;  // nenhum bloco anterior tocou o grupo
+    }
+
+    int first = ooc->group_start[group];
+    int status = 0;
+    int header[2];
+    ItemSimilarity *row = malloc((size_t)lists->k * sizeof(ItemSimilarity));
+    while (status == 0 && row && fread(header, sizeof(int), 2, file) == 2) {
+        if (header[1] > lists->k ||
+            fread(row, sizeof(ItemSimilarity), header[1], file) != (size_t)header[1]) {
+            status = -1;
+            break;
+        }
+        for (int n = 0; n < header[1]; n++) {
+            neighbor_index_offer(lists, header[0] - first, row[n].item_id, row[n].similarity);
+        }
+    }
+    if (!row) status = -1;
+    free(row);
+    fclose(file);
+    unlink(path);
+    if (status != 0) {
+        fprintf(stderr, "Erro ao ler o arquivo temporário: %s\n", path);
+    }
+    return status;
+}
+
+/**
+ * Listas finais do grupo, ordenadas, na sua posição do modelo
+ */
+static int write_group_lists(ModelWriter *writer, NeighborIndex *lists, int first) {
+    neighbor_index_finalize(lists);
+    for (int r = 0; r < lists->num_items; r++) {
+        ItemSimilarity *row = lists->entries + (size_t)r * lists->k;
+        memset(row + lists->count[r], 0, (lists->k - lists->count[r]) * sizeof(ItemSimilarity));
+    }
+    const ModelHeader *h = &writer->header;
+    int status = model_writer_put(writer, h->count_offset + (uint64_t)first * sizeof(int32_t),
+                                  lists->count, lists->num_items * sizeof(int32_t));
+    status |= model_writer_put(writer,
+                               h->entries_offset + (uint64_t)first * h->k * sizeof(ItemSimilarity),
+                               lists->entries,
+                               (size_t)lists->num_items * h->k * sizeof(ItemSimilarity));
+    return status;
+}
+
+static size_t lists_bytes(int items, int k) {
+    return (size_t)items * (k * sizeof(ItemSimilarity) + 2 * sizeof(int) + sizeof(float) + 1);
+}
+
+/**
+ * Etapa 3: blocos (p, q), p <= q, em ordem de linha
+ */
+static int compute_blocks(OutOfCore *ooc, ModelWriter *writer, OutOfCoreBlockFn compute_block,
+                          void *ctx) {
+    const OutOfCoreParams *params = ooc->params;
+    int workers = params->num_workers;
+    int max_group = 0;
+    for (int g = 0; g < ooc->num_groups; g++) {
+        int len = ooc->group_start[g + 1] - ooc->group_start[g];
+        if (len > max_group) max_group = len;
+    }
+
+    char path[PATH_MAX];
+    temp_path(ooc, path, "csc", -1);
+    FILE *csc = fopen(path, "rb");
+    AllPairsWorkspace *workspaces = calloc(workers, sizeof(AllPairsWorkspace));
+    if (!csc || !workspaces) {
+        fprintf(stderr, "Erro ao abrir arquivo temporário: %s\n", path);
+        if (csc) fclose(csc);
+        free(workspaces);
+        return -1;
+    }
+    int status = 0;
+    for (int w = 0; w < workers && status == 0; w++) {
+        status = allpairs_workspace_init(&workspaces[w], 2 * max_group);
+    }
+    size_t ws_bytes = (size_t)workers * 2 * max_group *
+                      (sizeof(PairAccum) + 1 + sizeof(int) + sizeof(float));
+    account(ooc, ws_bytes);
+
+    for (int p = 0; p < ooc->num_groups && status == 0; p++) {
+        int row_begin = ooc->group_start[p];
+        int rows = ooc->group_start[p + 1] - row_begin;
+        NeighborIndex row_lists;
+        if (neighbor_index_init(&row_lists, rows, params->top_k, params->min_similarity) != 0) {
+            status = -1;
+            break;
+        }
+        account(ooc, lists_bytes(rows, params->top_k));
+
+        int na = 0;
+        Rating *a = NULL;
+        status = merge_spilled(ooc, &row_lists, p);
+        if (status == 0 && !(a = load_columns(ooc, csc, row_begin, row_begin + rows, &na))) {
+            status = -1;
+        }
+        account(ooc, (size_t)na * BLOCK_BYTES_PER_RATING);
+
+        for (int q = p; q < ooc->num_groups && status == 0; q++) {
+            int col_begin = ooc->group_start[q];
+            int cols = q > p ? ooc->group_start[q + 1] - col_begin : 0;
+            int nb = 0;
+            Rating *b = NULL;
+            if (q > p && na > 0 && !(b = load_columns(ooc, csc, col_begin, col_begin + cols, &nb))) {
+                status = -1;
+                break;
+            }
+            account(ooc, (size_t)nb * BLOCK_BYTES_PER_RATING);
+
+            // Grupos sem avaliações não formam nenhum par
+            if (na > 0 && (q == p || nb > 0)) {
+                RatingStore local;
+                int *users = NULL;
+                NeighborIndex col_lists;
+                memset(&col_lists, 0, sizeof(col_lists));
+                if (build_block_store(ooc, a, na, row_begin, rows, b, nb, col_begin, cols,
+                                      &local, &users) != 0) {
+                    fprintf(stderr, "Erro: memória insuficiente para o bloco (%d, %d)\n", p, q);
+                    status = -1;
+                } else if (q > p && neighbor_index_init(&col_lists, cols, params->top_k,
+                                                        params->min_similarity) != 0) {
+                    status = -1;
+                } else {
+                    account(ooc, lists_bytes(cols, params->top_k));
+                    OutOfCoreBlock block = { &local, row_begin, rows, col_begin, cols, &row_lists,
+                                             q > p ? &col_lists : NULL, workspaces };
+                    compute_block(&block, ctx);
+                    ooc->stats->num_blocks++;
+                    if (q > p) {
+                        status = spill_lists(ooc, &col_lists, q);
+                    }
+                    release(ooc, lists_bytes(cols, params->top_k));
+                }
+                if (users) {
+                    rating_store_free(&local);
+                    free(users);
+                }
+                neighbor_index_free(&col_lists);
+            }
+            release(ooc, (size_t)nb * BLOCK_BYTES_PER_RATING);
+            free(b);
+        }
+
+        if (status == 0) {
+            status = write_group_lists(writer, &row_lists, row_begin);
+        }
+        release(ooc, (size_t)na * BLOCK_BYTES_PER_RATING + lists_bytes(rows, params->top_k));
+        free(a);
+        neighbor_index_free(&row_lists);
+    }
+
+    for (int w = 0; w < workers; w++) {
+        ooc->stats->common_pairs += workspaces[w].pairs;
+        allpairs_workspace_free(&workspaces[w]);
+    }
+    release(ooc, ws_bytes);
+    free(workspaces);
+    fclose(csc);
+    return status;
+}
+
+int outofcore_build(const char *ratings_path, const char *model_path,
+                    const OutOfCoreParams *params, const ModelBuildInfo *info,
+                    OutOfCoreBlockFn compute_block, void *ctx, OutOfCoreStats *stats) {
+    memset(stats, 0, sizeof(*stats));
+    if (params->top_k <= 0 || !model_path) {
+        fprintf(stderr, "Erro: o build fora da memória exige --topk e --save-model\n");
+        return -1;
+    }
+    if (params->memory_budget < minimum_budget()) {
+        fprintf(stderr, "Erro: orçamento de %.2f MB menor que os buffers mínimos de leitura "
+                "e cópia (%.2f MB)\n", params->memory_budget / 1e6, minimum_budget() / 1e6);
+        return -1;
+    }
+
+    OutOfCore ooc;
+    memset(&ooc, 0, sizeof(ooc));
+    OutOfCoreParams local_params = *params;
+    if (local_params.num_workers <= 0) local_params.num_workers = 1;
+    ooc.params = &local_params;
+    ooc.stats = stats;
+
+    const char *dir = params->spill_dir;
+    if (!dir) dir = getenv("TMPDIR");
+    if (!dir) dir = "/tmp";
+    int length = snprintf(ooc.dir, sizeof(ooc.dir), "%s/recommender-XXXXXX", dir);
+    if (length >= (int)sizeof(ooc.dir) || !mkdtemp(ooc.dir)) {
+        fprintf(stderr, "Erro ao criar diretório temporário em %s\n", dir);
+        return -1;
+    }
+
+    double start = timer_now();
+    ModelWriter writer;
+    memset(&writer, 0, sizeof(writer));
+
+    int status = read_text_runs(&ooc, ratings_path);
+    if (status == 0) status = merge_user_order(&ooc);
+    if (status == 0) {
+        stats->num_users = ooc.num_users;
+        stats->num_items = ooc.num_items;
+        status = model_writer_open(&writer, model_path, ooc.num_users, ooc.num_items,
+                                   stats->num_ratings, params->top_k, params->min_similarity, info);
+    }
+    if (status == 0) status = write_csr_sections(&ooc, &writer);
+    if (status == 0) status = merge_item_order(&ooc);
+    stats->sort_seconds = timer_now() - start;
+
+    if (status == 0) status = plan_groups(&ooc);
+    if (status == 0) status = compute_blocks(&ooc, &writer, compute_block, ctx);
+    stats->similarity_seconds = timer_now() - start - stats->sort_seconds;
+
+    if (writer.file && model_writer_close(&writer, model_path, timer_now() - start) != 0) {
+        status = -1;
+    }
+    if (status != 0) {
+        unlink(model_path);
+    }
+
+    remove_temp_dir(&ooc);
+    free(ooc.item_count);
+    free(ooc.item_ptr);
+    free(ooc.user_mean);
+    free(ooc.item_mean);
+    free(ooc.group_start);
+    free(ooc.user_slot);
+    return status;
+}
+
+void outofcore_print_stats(const OutOfCoreStats *stats, const OutOfCoreParams *params, FILE *out) {
+    fprintf(out, "Build fora da memória: orçamento de %.1f MB, pico contabilizado de %.1f MB\n",
+            params->memory_budget / 1e6, stats->peak_bytes / 1e6);
+    if (stats->peak_bytes > params->memory_budget) {
+        // Colunas maiores que um grupo e buffers de fusão mínimos não se dividem
+        fprintf(out, "Aviso: o pico contabilizado passou do orçamento em %.2f MB\n",
+                (stats->peak_bytes - params->memory_budget) / 1e6);
+    }
+    fprintf(out, "Ordenação externa: %d pedaços em %.4f s\n", stats->num_runs, stats->sort_seconds);
+    fprintf(out, "Grupos de itens: %d (%lld blocos com avaliações) em %.4f s\n", stats->num_groups,
+            stats->num_blocks, stats->similarity_seconds);
+    fprintf(out, "Listas parciais em disco: %lld (%.1f MB)\n", stats->spilled_lists,
+            stats->spill_bytes / 1e6);
+}
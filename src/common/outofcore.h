@@ -0,0 +1,100 @@
+/**
+ * Build fora da memória (--memory-budget=MB)
+ *
+ * Para entradas maiores que a RAM, o modelo top-K é construído em disco
+ * com memória limitada por um orçamento:
+ *   1. o texto é lido em janelas; cada janela vira um pedaço ordenado por
+ *      (usuário, item) gravado num arquivo temporário;
+ *   2. a fusão dos pedaços (a última ocorrência vence, como na carga em
+ *      memória) grava o histórico CSR direto no modelo e, numa segunda
+ *      ordenação externa, um arquivo das avaliações por item (CSC);
+ *   3. os itens são divididos em grupos contíguos cujo par cabe no
+ *      orçamento; cada bloco (p, q), p <= q, carrega só as colunas dos dois
+ *      grupos e calcula os pares com avaliador comum (allpairs.h);
+ *   4. as listas do grupo p ficam em memória enquanto ele é a linha; as
+ *      contribuições para um grupo q > p são gravadas como listas parciais
+ *      top-K em disco e fundidas quando q vira a linha. Cada grupo
+ *      terminado é escrito na sua posição do modelo (ModelWriter).
+ * O resultado é idêntico ao do build em memória com --topk: a soma de
+ * cada par percorre os avaliadores comuns na mesma ordem e a seleção top-K
+ * não depende da ordem das ofertas.
+ *
+ * O orçamento cobre os buffers de leitura e ordenação, as colunas dos
+ * dois grupos de um bloco e as listas top-K em construção; os vetores por
+ * item e por usuário (ponteiros da CSC e médias da métrica) são
+ * descontados dele antes de dimensionar os grupos.
+ */
+
+#ifndef OUTOFCORE_H
+#define OUTOFCORE_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include "ratings.h"
+#include "neighbors.h"
+#include "allpairs.h"
+#include "metric.h"
+#include "model.h"
+
+typedef struct {
+    size_t memory_budget;     // bytes
+    const char *spill_dir;    // arquivos temporários (NULL: $TMPDIR ou /tmp)
+    int top_k;
+    float min_similarity;
+    SimilarityMetric metric;
+    int num_workers;          // threads que calculam linhas de um bloco
+} OutOfCoreParams;
+
+typedef struct {
+    int num_users;
+    int num_items;
+    int num_ratings;
+    int num_runs;             // pedaços ordenados gravados (nas duas ordenações)
+    int num_groups;
+    long long num_blocks;
+    long long common_pairs;   // pares com avaliador comum calculados
+    long long spilled_lists;  // listas parciais gravadas em disco
+    long long spill_bytes;
+    size_t peak_bytes;        // maior memória contabilizada
+    double sort_seconds;
+    double similarity_seconds;
+} OutOfCoreStats;
+
+/**
+ * Bloco (p, q) carregado: local tem as avaliações (já centradas pela
+ * métrica) dos itens do grupo p nos índices 0 .. rows - 1 e, fora da
+ * diagonal, os do grupo q em rows .. rows + cols - 1
+ */
+typedef struct {
+    const RatingStore *local;
+    int row_begin;            // item global da linha local 0
+    int rows;
+    int col_begin;            // item global da coluna local rows (q != p)
+    int cols;                 // 0 na diagonal
+    NeighborIndex *row_lists; // listas do grupo p (índice local)
+    NeighborIndex *col_lists; // listas parciais do grupo q (NULL na diagonal)
+    AllPairsWorkspace *workspaces;  // um por worker
+} OutOfCoreBlock;
+
+/**
+ * Calcula as linhas begin .. end - 1 de um bloco com o workspace `worker`.
+ * Seguro entre threads com workers diferentes (as listas têm trava por linha).
+ */
+void outofcore_block_rows(const OutOfCoreBlock *block, int begin, int end, int worker);
+
+/**
+ * Cada versão distribui as linhas de um bloco entre as suas threads
+ */
+typedef void (*OutOfCoreBlockFn)(const OutOfCoreBlock *block, void *ctx);
+
+/**
+ * Lê ratings_path (texto) e grava em model_path o modelo de vizinhos
+ * top-K; params->top_k precisa ser > 0
+ */
+int outofcore_build(const char *ratings_path, const char *model_path,
+                    const OutOfCoreParams *params, const ModelBuildInfo *info,
+                    OutOfCoreBlockFn compute_block, void *ctx, OutOfCoreStats *stats);
+
+void outofcore_print_stats(const OutOfCoreStats *stats, const OutOfCoreParams *params, FILE *out);
+
+#endif
@@ -0,0 +1,390 @@
+/**
+ * Leitor rápido de triplas - mmap + tokenizador próprio, em paralelo por pedaços
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "parser.h"
+
+typedef struct {
+    const char *begin;
+    const char *end;
+    int max_items;
+    IdMap *users;       // IDs como tokens (NULL: inteiros usados como índice)
+    IdMap *items;
+    Rating *triples;
+    int count;
+    int capacity;
+    int skipped;        // IDs fora do limite
+    int malformed;      // parou num token inválido
+    int out_of_memory;
+} ParseChunk;
+
+static int is_space(char c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+static const char *skip_spaces(const char *p, const char *end) {
+    while (p < end && is_space(*p)) p++;
+    return p;
+}
+
+/**
+ * Inteiro decimal com sinal opcional; retorna o fim do token ou NULL
+ */
+static const char *parse_int(const char *p, const char *end, int *out) {
+    int negative = 0;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = (*p == '-');
+        p++;
+    }
+    if (p == end || *p < '0' || *p > '9') return NULL;
+
+    long long value = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        value = value * 10 + (*p - '0');
+        if (value > 2147483648LL) return NULL;
+        p++;
+    }
+    if (p < end && !is_space(*p)) return NULL;
+
+    value = negative ? -value : value;
+    if (value > 2147483647LL) return NULL;
+    *out = (int)value;
+    return p;
+}
+
+/**
+ * Float decimal. Caminho rápido para "123.45" com até 15 dígitos e até 7
+ * casas decimais: m / 10^e em double é arredondado corretamente e o
+ * segundo arredondamento para float não pode errar nessa faixa, então o
+ * resultado é o mesmo de strtof. Qualquer outra forma usa strtof.
+ */
+static const char *parse_float(const char *p, const char *end, float *out) {
+    static const double pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7 };
+    const char *start = p;
+    int negative = 0;
+
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = (*p == '-');
+        p++;
+    }
+
+    unsigned long long mantissa = 0;
+    int digits = 0;
+    int decimals = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        mantissa = mantissa * 10 + (*p++ - '0');
+        digits++;
+    }
+    if (p < end && *p == '.') {
+        p++;
+        while (p < end && *p >= '0' && *p <= '9') {
+            mantissa = mantissa * 10 + (*p++ - '0');
+            digits++;
+            decimals++;
+        }
+    }
+
+    if (digits > 0 && digits <= 15 && decimals <= 7 && (p == end || is_space(*p))) {
+        double value = (double)mantissa / pow10[decimals];
+        *out = (float)(negative ? -value : value);
+        return p;
+    }
+
+    // Caminho lento: expoente, inf/nan, muitos dígitos, ...
+    char buffer[64];
+    const char *token_end = start;
+    while (token_end < end && !is_space(*token_end)) token_end++;
+    size_t len = token_end - start;
+    if (len == 0 || len >= sizeof(buffer)) return NULL;
+
+    memcpy(buffer, start, len);
+    buffer[len] = '\0';
+    char *parsed_end;
+    float value = strtof(buffer, &parsed_end);
+    if (parsed_end != buffer + len) return NULL;
+
+    *out = value;
+    return token_end;
+}
+
+/**
+ * Token qualquer até o próximo espaço; retorna o fim ou NULL se vazio
+ */
+static const char *parse_token(const char *p, const char *end) {
+    const char *start = p;
+    while (p < end && !is_space(*p)) p++;
+    return p > start ? p : NULL;
+}
+
+/**
+ * Índices de dois tokens nos mapas do pedaço (-1 se faltar memória)
+ */
+static int insert_keys(ParseChunk *chunk, const char *user_key, const char *user_end,
+                       const char *item_key, const char *item_end, int *user, int *item) {
+    *user = id_map_insert(chunk->users, user_key, user_end - user_key);
+    *item = id_map_insert(chunk->items, item_key, item_end - item_key);
+    return *user < 0 || *item < 0 ? -1 : 0;
+}
+
+static void *parse_chunk(void *arg) {
+    ParseChunk *chunk = (ParseChunk *)arg;
+    const char *p = chunk->begin;
+    const char *end = chunk->end;
+
+    for (;;) {
+        int user, item;
+        float rating;
+
+        p = skip_spaces(p, end);
+        if (p == end) break;
+
+        if (chunk->users) {
+            const char *user_key = p;
+            const char *user_end = parse_token(p, end);
+            const char *item_key = user_end ? skip_spaces(user_end, end) : NULL;
+            const char *item_end = item_key ? parse_token(item_key, end) : NULL;
+            if (!item_end || !(p = parse_float(skip_spaces(item_end, end), end, &rating))) {
+                chunk->malformed = 1;
+                break;
+            }
+            if (insert_keys(chunk, user_key, user_end, item_key, item_end, &user, &item) != 0) {
+                chunk->out_of_memory = 1;
+                break;
+            }
+        } else if (!(p = parse_int(p, end, &user)) ||
+                   !(p = parse_int(skip_spaces(p, end), end, &item)) ||
+                   !(p = parse_float(skip_spaces(p, end), end, &rating))) {
+            chunk->malformed = 1;
+            break;
+        }
+
+        if (user < 0 || item < 0 || (chunk->max_items > 0 && item >= chunk->max_items)) {
+            chunk->skipped++;
+            continue;
+        }
+
+        if (chunk->count == chunk->capacity) {
+            int capacity = chunk->capacity ? chunk->capacity * 2 : 1 << 14;
+            Rating *grown = realloc(chunk->triples, capacity * sizeof(Rating));
+            if (!grown) {
+                chunk->out_of_memory = 1;
+                break;
+            }
+            chunk->triples = grown;
+            chunk->capacity = capacity;
+        }
+
+        chunk->triples[chunk->count].user_id = user;
+        chunk->triples[chunk->count].item_id = item;
+        chunk->triples[chunk->count].rating = rating;
+        chunk->count++;
+    }
+
+    return NULL;
+}
+
+/**
+ * Traduz os índices locais das triplas de um pedaço para os dos mapas
+ * globais, inserindo as chaves do pedaço neles
+ */
+static int merge_chunk_keys(ParseChunk *chunk, IdMap *users, IdMap *items) {
+    int *user_ids = malloc((chunk->users->count > 0 ? chunk->users->count : 1) * sizeof(int));
+    int *item_ids = malloc((chunk->items->count > 0 ? chunk->items->count : 1) * sizeof(int));
+    int status = user_ids && item_ids ? 0 : -1;
+
+    for (int id = 0; id < chunk->users->count && status == 0; id++) {
+        const char *key = id_map_key(chunk->users, id);
+        if ((user_ids[id] = id_map_insert(users, key, strlen(key))) < 0) status = -1;
+    }
+    for (int id = 0; id < chunk->items->count && status == 0; id++) {
+        const char *key = id_map_key(chunk->items, id);
+        if ((item_ids[id] = id_map_insert(items, key, strlen(key))) < 0) status = -1;
+    }
+    for (int k = 0; k < chunk->count && status == 0; k++) {
+        chunk->triples[k].user_id = user_ids[chunk->triples[k].user_id];
+        chunk->triples[k].item_id = item_ids[chunk->triples[k].item_id];
+    }
+
+    free(user_ids);
+    free(item_ids);
+    return status;
+}
+
+/**
+ * Leitura em pedaços; com users/items != NULL os IDs são tokens e o
+ * primeiro pedaço insere direto nos mapas globais, os demais em mapas
+ * próprios fundidos depois, na ordem do arquivo
+ */
+static int parse_buffer(const char *data, size_t size, int max_items, int num_threads,
+                        IdMap *users, IdMap *items, Rating **triples, int *count,
+                        int *skipped, int *malformed) {
+    if (num_threads < 1) num_threads = 1;
+    if ((size_t)num_threads > size / 4096 + 1) num_threads = size / 4096 + 1;
+
+    // Pedaços de tamanho igual, com as fronteiras avançadas até a próxima linha
+    ParseChunk *chunks = calloc(num_threads, sizeof(ParseChunk));
+    if (!chunks) {
+        return -1;
+    }
+    const char *cursor = data;
+    const char *data_end = data + size;
+    for (int t = 0; t < num_threads; t++) {
+        const char *chunk_end = t == num_threads - 1 ? data_end : data + size / num_threads * (t + 1);
+        if (chunk_end < cursor) chunk_end = cursor;
+        while (chunk_end < data_end && *chunk_end != '\n') chunk_end++;
+
+        chunks[t].begin = cursor;
+        chunks[t].end = chunk_end;
+        chunks[t].max_items = max_items;
+        cursor = chunk_end;
+    }
+
+    int status = 0;
+    for (int t = 0; t < num_threads && users; t++) {
+        if (t == 0) {
+            chunks[t].users = users;
+            chunks[t].items = items;
+            continue;
+        }
+        chunks[t].users = calloc(1, sizeof(IdMap));
+        chunks[t].items = calloc(1, sizeof(IdMap));
+        if (!chunks[t].users || !chunks[t].items ||
+            id_map_init(chunks[t].users) != 0 || id_map_init(chunks[t].items) != 0) {
+            chunks[t].out_of_memory = 1;  // sem mapas: o pedaço não é lido
+            chunks[t].end = chunks[t].begin;
+            status = -1;
+        }
+    }
+
+    if (num_threads == 1) {
+        parse_chunk(&chunks[0]);
+    } else {
+        pthread_t threads[num_threads];
+        int started[num_threads];
+        for (int t = 0; t < num_threads; t++) {
+            started[t] = pthread_create(&threads[t], NULL, parse_chunk, &chunks[t]) == 0;
+            if (!started[t]) {
+                parse_chunk(&chunks[t]);
+            }
+        }
+        for (int t = 0; t < num_threads; t++) {
+            if (started[t]) pthread_join(threads[t], NULL);
+        }
+    }
+
+    // Concatena na ordem original, parando no primeiro pedaço malformado
+    int total = 0;
+    int used = 0;
+    *skipped = 0;
+    *malformed = 0;
+    while (used < num_threads && !*malformed) {
+        total += chunks[used].count;
+        *skipped += chunks[used].skipped;
+        *malformed = chunks[used].malformed;
+        if (chunks[used].out_of_memory) status = -1;
+        if (status == 0 && users && used > 0 && merge_chunk_keys(&chunks[used], users, items) != 0) {
+            status = -1;
+        }
+        used++;
+    }
+
+    Rating *all = status == 0 ? malloc((total > 0 ? total : 1) * sizeof(Rating)) : NULL;
+    if (!all) status = -1;
+    int pos = 0;
+    for (int t = 0; t < used && all; t++) {
+        memcpy(all + pos, chunks[t].triples, chunks[t].count * sizeof(Rating));
+        pos += chunks[t].count;
+    }
+
+    for (int t = 0; t < num_threads; t++) {
+        free(chunks[t].triples);
+        if (t > 0 && users) {
+            if (chunks[t].users) id_map_free(chunks[t].users);
+            if (chunks[t].items) id_map_free(chunks[t].items);
+            free(chunks[t].users);
+            free(chunks[t].items);
+        }
+    }
+    free(chunks);
+
+    if (status != 0) {
+        free(all);
+        return -1;
+    }
+    *triples = all;
+    *count = total;
+    return 0;
+}
+
+int parse_ratings_buffer(const char *data, size_t size, int max_items, int num_threads,
+                         Rating **triples, int *count, int *skipped, int *malformed) {
+    return parse_buffer(data, size, max_items, num_threads, NULL, NULL, triples, count,
+                        skipped, malformed);
+}
+
+static int parse_file(const char *filename, int max_items, int num_threads, IdMap *users,
+                      IdMap *items, Rating **triples, int *count, long long *bytes) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Erro ao abrir arquivo: %s\n", filename);
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        fprintf(stderr, "Erro ao abrir arquivo: %s\n", filename);
+        close(fd);
+        return -1;
+    }
+
+    size_t size = st.st_size;
+    const char *data = NULL;
+    if (size > 0) {
+        data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            fprintf(stderr, "Erro no mmap de %s\n", filename);
+            close(fd);
+            return -1;
+        }
+        madvise((void *)data, size, MADV_SEQUENTIAL);
+    }
+    close(fd);
+
+    int skipped, malformed;
+    int status = parse_buffer(data, size, max_items, num_threads, users, items, triples, count,
+                              &skipped, &malformed);
+    if (data) {
+        munmap((void *)data, size);
+    }
+
+    if (status != 0) {
+        fprintf(stderr, "Erro: memória insuficiente ao ler %s\n", filename);
+        return -1;
+    }
+    if (malformed) {
+        fprintf(stderr, "Aviso: leitura interrompida em token inválido em %s\n", filename);
+    }
+    if (skipped > 0) {
+        fprintf(stderr, "Aviso: %d avaliações com ID fora do limite ignoradas\n", skipped);
+    }
+    if (bytes) *bytes = size;
+    return 0;
+}
+
+int parse_ratings_file(const char *filename, int max_items, int num_threads,
+                       Rating **triples, int *count, long long *bytes) {
+    return parse_file(filename, max_items, num_threads, NULL, NULL, triples, count, bytes);
+}
+
+int parse_ratings_file_keys(const char *filename, int num_threads, Rating **triples, int *count,
+                            IdMap *users, IdMap *items, long long *bytes) {
+    return parse_file(filename, 0, num_threads, users, items, triples, count, bytes);
+}
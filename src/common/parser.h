@@ -0,0 +1,43 @@
+/**
+ * Leitor rápido de triplas "user_id item_id rating"
+ *
+ * O arquivo é mapeado com mmap e lido por um tokenizador próprio de
+ * inteiros/floats (sem fscanf). Com mais de uma thread, o arquivo é
+ * dividido em pedaços alinhados a quebras de linha, lidos em paralelo e
+ * concatenados na ordem original.
+ */
+
+#ifndef PARSER_H
+#define PARSER_H
+
+#include "ratings.h"
+#include "idmap.h"
+
+/**
+ * Lê todas as triplas de `filename`. Itens com ID >= max_items (se
+ * max_items > 0) e IDs negativos são descartados. A leitura para no
+ * primeiro token malformado, como o laço com fscanf fazia.
+ * Em caso de sucesso, *triples deve ser liberado com free().
+ */
+int parse_ratings_file(const char *filename, int max_items, int num_threads,
+                       Rating **triples, int *count, long long *bytes);
+
+/**
+ * Lê as triplas de um trecho de texto já em memória (por exemplo, a faixa
+ * de bytes de um processo MPI), sem imprimir avisos: *skipped recebe o
+ * número de IDs fora do limite e *malformed indica que a leitura parou
+ * num token inválido.
+ */
+int parse_ratings_buffer(const char *data, size_t size, int max_items, int num_threads,
+                         Rating **triples, int *count, int *skipped, int *malformed);
+
+/**
+ * Como parse_ratings_file(), com IDs de usuário e item quaisquer (tokens
+ * sem espaços, idmap.h): cada ID distinto recebe um índice provisório em
+ * users/items (já inicializados) e as triplas usam esses índices. Nenhum
+ * ID é descartado aqui.
+ */
+int parse_ratings_file_keys(const char *filename, int num_threads, Rating **triples, int *count,
+                            IdMap *users, IdMap *items, long long *bytes);
+
+#endif
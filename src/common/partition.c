@@ -0,0 +1,140 @@
+/**
+ * Partição balanceada do triângulo superior de pares
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "partition.h"
+
+long long triangle_pairs(int begin, int end, int n) {
+    if (end > n) end = n;
+    if (begin >= end) return 0;
+
+    // Soma de (n - 1 - i) para i em [begin, end)
+    long long rows = end - begin;
+    return rows * (n - 1) - ((long long)(begin + end - 1) * rows) / 2;
+}
+
+int triangle_partition(int n, int num_parts, int align, int *bounds) {
+    long long total = triangle_pairs(0, n, n);
+    if (num_parts < 1) num_parts = 1;
+    if (align < 1) align = 1;
+
+    int parts = 0;
+    int row = 0;
+    long long covered = 0;
+    bounds[0] = 0;
+
+    for (int t = 1; t < num_parts && row < n; t++) {
+        long long target = total * t / num_parts;
+
+        // Avança até a área acumulada alcançar a meta desta fronteira
+        while (row < n && covered < target) {
+            covered += n - 1 - row;
+            row++;
+        }
+
+        int bound = (row + align / 2) / align * align;
+        if (bound > n) bound = n;
+        if (bound > bounds[parts]) {
+            bounds[++parts] = bound;
+        }
+    }
+    if (bounds[parts] < n) {
+        bounds[++parts] = n;
+    }
+    return parts;
+}
+
+int pair_grid_init(PairGrid *grid, int n, int num_ranks) {
+    if (num_ranks < 1) num_ranks = 1;
+
+    // floor(sqrt(P)) linhas; as P % rows primeiras têm um processo a mais
+    grid->rows = 1;
+    while ((long long)(grid->rows + 1) * (grid->rows + 1) <= num_ranks) {
+        grid->rows++;
+    }
+    grid->cols = (num_ranks + grid->rows - 1) / grid->rows;
+    grid->num_ranks = num_ranks;
+
+    grid->num_groups = PAIR_GRID_CYCLES * num_ranks;
+    if (grid->num_groups > n) grid->num_groups = n > 0 ? n : 1;
+
+    grid->group_start = malloc((grid->num_groups + 1) * sizeof(int));
+    if (!grid->group_start) {
+        fprintf(stderr, "Erro: memória insuficiente para a grade de pares\n");
+        return -1;
+    }
+    for (int g = 0; g <= grid->num_groups; g++) {
+        grid->group_start[g] = (int)((long long)n * g / grid->num_groups);
+    }
+    return 0;
+}
+
+void pair_grid_free(PairGrid *grid) {
+    free(grid->group_start);
+    grid->group_start = NULL;
+}
+
+/**
+ * Linha da grade que contém o processo `rank`
+ */
+static int grid_row(const PairGrid *grid, int rank) {
+    int base = grid->num_ranks / grid->rows;
+    int extra = grid->num_ranks % grid->rows;
+    if (rank < extra * (base + 1)) {
+        return rank / (base + 1);
+    }
+    return extra + (rank - extra * (base + 1)) / base;
+}
+
+/**
+ * Primeiro processo da linha e número de processos dela
+ */
+static int row_first(const PairGrid *grid, int row) {
+    int base = grid->num_ranks / grid->rows;
+    int extra = grid->num_ranks % grid->rows;
+    return row * base + (row < extra ? row : extra);
+}
+
+static int row_size(const PairGrid *grid, int row) {
+    return grid->num_ranks / grid->rows + (row < grid->num_ranks % grid->rows);
+}
+
+int pair_grid_owner(const PairGrid *grid, int p, int q) {
+    if ((q - p) / grid->num_ranks % 2) {
+        int tmp = p;
+        p = q;
+        q = tmp;
+    }
+    int row = grid_row(grid, p % grid->num_ranks);
+    return row_first(grid, row) + q % row_size(grid, row);
+}
+
+int pair_grid_group_of(const PairGrid *grid, int item) {
+    int lo = 0;
+    int hi = grid->num_groups - 1;
+    while (lo < hi) {
+        int mid = lo + (hi - lo + 1) / 2;
+        if (grid->group_start[mid] <= item) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return lo;
+}
+
+int pair_grid_needs_group(const PairGrid *grid, int rank, int g) {
+    int row = grid_row(grid, rank);
+    return grid_row(grid, g % grid->num_ranks) == row ||
+           g % row_size(grid, row) == rank - row_first(grid, row);
+}
+
+long long pair_grid_block_pairs(const PairGrid *grid, int p, int q) {
+    long long sp = grid->group_start[p + 1] - grid->group_start[p];
+    if (p == q) {
+        return sp * (sp - 1) / 2;
+    }
+    return sp * (grid->group_start[q + 1] - grid->group_start[q]);
+}
@@ -0,0 +1,78 @@
+/**
+ * Partição balanceada do triângulo superior de pares (i, j), j > i
+ *
+ * A linha i tem n - 1 - i pares, então faixas com o mesmo número de
+ * linhas têm trabalhos muito diferentes (a primeira faixa tem quase o
+ * dobro de pares da média). Aqui as faixas são contíguas em linhas mas
+ * têm áreas (número de pares) aproximadamente iguais.
+ */
+
+#ifndef PARTITION_H
+#define PARTITION_H
+
+/**
+ * Número de pares (i, j), j > i, com begin <= i < end num triângulo de n itens
+ */
+long long triangle_pairs(int begin, int end, int n);
+
+/**
+ * Divide as linhas 0 .. n - 1 em até num_parts faixas de área parecida,
+ * com fronteiras múltiplas de `align` (>= 1). A faixa t é
+ * [bounds[t], bounds[t + 1]); bounds precisa de num_parts + 1 posições.
+ * Retorna o número de faixas não vazias.
+ */
+int triangle_partition(int n, int num_parts, int align, int *bounds);
+
+/**
+ * Decomposição 2D bloco-cíclica do espaço de pares (versão MPI)
+ *
+ * Os itens são divididos em grupos contíguos; o bloco (p, q), p <= q,
+ * reúne os pares entre o grupo p e o grupo q. Os P processos formam
+ * rows = floor(sqrt(P)) linhas de processos consecutivos, com P / rows ou
+ * P / rows + 1 processos cada (P primo não vira uma grade 1 x P). A linha
+ * do bloco é a que contém o processo p mod P, então cada linha recebe uma
+ * fração dos grupos proporcional ao seu tamanho; dentro da linha, a coluna
+ * é q mod (processos da linha). Quando (q - p) / P é ímpar os papéis de p e
+ * q se invertem, alternando ao longo das diagonais os blocos acima e
+ * abaixo da diagonal e equilibrando o trabalho do triângulo. Um processo
+ * só toca os grupos da sua linha e os da sua coluna: cerca de
+ * 1/rows + 1/cols dos itens. Com P < 4 há uma só linha e todo processo
+ * precisa de todos os grupos.
+ */
+#define PAIR_GRID_CYCLES 4   // voltas da grade (grupos = 4 * P)
+
+typedef struct {
+    int rows;
+    int cols;           // processos da maior linha
+    int num_ranks;
+    int num_groups;
+    int *group_start;   // num_groups + 1
+} PairGrid;
+
+/**
+ * Grade quase quadrada para num_ranks processos sobre n itens
+ */
+int pair_grid_init(PairGrid *grid, int n, int num_ranks);
+void pair_grid_free(PairGrid *grid);
+
+/**
+ * Processo dono do bloco (p, q), p <= q
+ */
+int pair_grid_owner(const PairGrid *grid, int p, int q);
+
+/**
+ * Grupo do item (busca binária em group_start)
+ */
+int pair_grid_group_of(const PairGrid *grid, int item);
+
+/**
+ * Se algum bloco do processo pode envolver o grupo g
+ */
+int pair_grid_needs_group(const PairGrid *grid, int rank, int g);
+
+/**
+ * Número de pares (i, j), i < j, do bloco (p, q), p <= q
+ */
+long long pair_grid_block_pairs(const PairGrid *grid, int p, int q);
+
+#endif
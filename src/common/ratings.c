@@ -0,0 +1,314 @@
+/**
+ * Armazenamento esparso de avaliações - construção das visões CSR/CSC
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ratings.h"
+#include "parser.h"
+#include "ratings_binary.h"
+#include "timer.h"
+
+/**
+ * Ordena por (usuário, item); empates mantêm a ordem do arquivo
+ * graças ao índice original guardado em seq.
+ */
+typedef struct {
+    int user_id;
+    int item_id;
+    int seq;
+    float rating;
+} SortEntry;
+
+static int compare_entry(const void *a, const void *b) {
+    const SortEntry *ea = (const SortEntry *)a;
+    const SortEntry *eb = (const SortEntry *)b;
+
+    if (ea->user_id != eb->user_id) return ea->user_id < eb->user_id ? -1 : 1;
+    if (ea->item_id != eb->item_id) return ea->item_id < eb->item_id ? -1 : 1;
+    return ea->seq < eb->seq ? -1 : (ea->seq > eb->seq);
+}
+
+int rating_store_build(RatingStore *rs, Rating *triples, int count) {
+    return rating_store_build_sized(rs, triples, count, 0, 0);
+}
+
+int rating_store_build_sized(RatingStore *rs, Rating *triples, int count,
+                             int num_users, int num_items) {
+    memset(rs, 0, sizeof(*rs));
+    rs->num_users = num_users;
+    rs->num_items = num_items;
+
+    SortEntry *entries = malloc((count > 0 ? count : 1) * sizeof(SortEntry));
+    if (!entries) {
+        fprintf(stderr, "Erro: memória insuficiente para %d avaliações\n", count);
+        return -1;
+    }
+
+    for (int k = 0; k < count; k++) {
+        entries[k].user_id = triples[k].user_id;
+        entries[k].item_id = triples[k].item_id;
+        entries[k].seq = k;
+        entries[k].rating = triples[k].rating;
+        if (triples[k].user_id >= rs->num_users) rs->num_users = triples[k].user_id + 1;
+        if (triples[k].item_id >= rs->num_items) rs->num_items = triples[k].item_id + 1;
+    }
+
+    qsort(entries, count, sizeof(SortEntry), compare_entry);
+
+    // Remove duplicatas (última ocorrência vence) e notas não positivas
+    int nnz = 0;
+    for (int k = 0; k < count; k++) {
+        if (k + 1 < count &&
+            entries[k + 1].user_id == entries[k].user_id &&
+            entries[k + 1].item_id == entries[k].item_id) {
+            continue;
+        }
+        if (entries[k].rating > 0) {
+            entries[nnz++] = entries[k];
+        }
+    }
+    rs->num_ratings = nnz;
+
+    rs->user_ptr = calloc(rs->num_users + 1, sizeof(int));
+    rs->user_items = malloc((nnz > 0 ? nnz : 1) * sizeof(int));
+    rs->user_ratings = malloc((nnz > 0 ? nnz : 1) * sizeof(float));
+    if (!rs->user_ptr || !rs->user_items || !rs->user_ratings) {
+        fprintf(stderr, "Erro: memória insuficiente para o armazenamento esparso\n");
+        free(entries);
+        rating_store_free(rs);
+        return -1;
+    }
+
+    // CSR: as entradas já estão ordenadas por (usuário, item)
+    for (int k = 0; k < nnz; k++) {
+        rs->user_ptr[entries[k].user_id + 1]++;
+        rs->user_items[k] = entries[k].item_id;
+        rs->user_ratings[k] = entries[k].rating;
+    }
+    for (int u = 0; u < rs->num_users; u++) {
+        rs->user_ptr[u + 1] += rs->user_ptr[u];
+    }
+
+    free(entries);
+    return rating_store_build_csc(rs);
+}
+
+int rating_store_build_csc(RatingStore *rs) {
+    int nnz = rs->num_ratings;
+
+    free(rs->item_ptr);
+    free(rs->item_users);
+    free(rs->item_ratings);
+    rs->item_ptr = calloc(rs->num_items + 1, sizeof(int));
+    rs->item_users = malloc((nnz > 0 ? nnz : 1) * sizeof(int));
+    rs->item_ratings = malloc((nnz > 0 ? nnz : 1) * sizeof(float));
+    int *fill = malloc((rs->num_items + 1) * sizeof(int));
+    if (!rs->item_ptr || !rs->item_users || !rs->item_ratings || !fill) {
+        fprintf(stderr, "Erro: memória insuficiente para o armazenamento esparso\n");
+        free(fill);
+        rating_store_free(rs);
+        return -1;
+    }
+
+    for (int k = 0; k < nnz; k++) {
+        rs->item_ptr[rs->user_items[k] + 1]++;
+    }
+    for (int i = 0; i < rs->num_items; i++) {
+        rs->item_ptr[i + 1] += rs->item_ptr[i];
+    }
+
+    // Percorrer o CSR em ordem de usuário deixa cada coluna ordenada
+    memcpy(fill, rs->item_ptr, (rs->num_items + 1) * sizeof(int));
+    for (int u = 0; u < rs->num_users; u++) {
+        for (int k = rs->user_ptr[u]; k < rs->user_ptr[u + 1]; k++) {
+            int pos = fill[rs->user_items[k]]++;
+            rs->item_users[pos] = u;
+            rs->item_ratings[pos] = rs->user_ratings[k];
+        }
+    }
+
+    free(fill);
+    return 0;
+}
+
+int rating_store_load(RatingStore *rs, const char *filename, int max_items,
+                      int num_threads, LoadStats *stats) {
+    Rating *triples;
+    int count;
+    long long bytes;
+
+    double start = timer_now();
+    if (ratings_binary_detect(filename)) {
+        // Formato binário já vem ordenado e sem duplicatas: sem etapa de parsing
+        int status = ratings_binary_load(rs, filename, max_items);
+        if (stats) {
+            stats->parse_seconds = 0.0;
+            stats->build_seconds = timer_now() - start;
+            stats->bytes = 0;
+            stats->threads = 1;
+        }
+        return status;
+    }
+
+    if (parse_ratings_file(filename, max_items, num_threads, &triples, &count, &bytes) != 0) {
+        return -1;
+    }
+    double parsed = timer_now();
+
+    int status = rating_store_build(rs, triples, count);
+    free(triples);
+
+    if (stats) {
+        stats->parse_seconds = parsed - start;
+        stats->build_seconds = timer_now() - parsed;
+        stats->bytes = bytes;
+        stats->threads = num_threads;
+    }
+    return status;
+}
+
+/**
+ * Troca os índices provisórios da leitura pelos da ordem canônica: os itens
+ * além de max_items saem (com as suas avaliações) e só os usuários que
+ * sobraram entram no dicionário
+ */
+static int remap_keys(Rating *triples, int *count, IdMap *users, IdMap *items, int max_items) {
+    int *item_remap = malloc((items->count > 0 ? items->count : 1) * sizeof(int));
+    int *user_remap = malloc((users->count > 0 ? users->count : 1) * sizeof(int));
+    unsigned char *used = calloc(users->count > 0 ? users->count : 1, 1);
+    int status = item_remap && user_remap && used ? 0 : -1;
+
+    if (status == 0 && id_map_sort(items, NULL, max_items, item_remap) != 0) {
+        status = -1;
+    }
+
+    int kept = 0;
+    for (int k = 0; k < *count && status == 0; k++) {
+        int item = item_remap[triples[k].item_id];
+        if (item < 0) {
+            continue;
+        }
+        triples[kept] = triples[k];
+        triples[kept].item_id = item;
+        used[triples[kept].user_id] = 1;
+        kept++;
+    }
+
+    if (status == 0 && id_map_sort(users, used, 0, user_remap) != 0) {
+        status = -1;
+    }
+    for (int k = 0; k < kept && status == 0; k++) {
+        triples[k].user_id = user_remap[triples[k].user_id];
+    }
+
+    if (status == 0 && kept < *count) {
+        fprintf(stderr, "Aviso: %d avaliações de itens além do limite de %d ignoradas\n",
+                *count - kept, max_items);
+    }
+    *count = kept;
+
+    free(item_remap);
+    free(user_remap);
+    free(used);
+    if (status != 0) {
+        fprintf(stderr, "Erro: memória insuficiente para o dicionário de IDs\n");
+    }
+    return status;
+}
+
+int rating_store_load_keys(RatingStore *rs, const char *filename, int max_items,
+                           int num_threads, LoadStats *stats) {
+    if (ratings_binary_detect(filename)) {
+        fprintf(stderr, "Erro: --remap-ids exige um arquivo texto: %s\n", filename);
+        return -1;
+    }
+
+    IdMap *users = malloc(sizeof(IdMap));
+    IdMap *items = malloc(sizeof(IdMap));
+    if (!users || !items || id_map_init(users) != 0) {
+        free(users);
+        free(items);
+        fprintf(stderr, "Erro: memória insuficiente para o dicionário de IDs\n");
+        return -1;
+    }
+    if (id_map_init(items) != 0) {
+        id_map_free(users);
+        free(users);
+        free(items);
+        fprintf(stderr, "Erro: memória insuficiente para o dicionário de IDs\n");
+        return -1;
+    }
+
+    Rating *triples = NULL;
+    int count;
+    long long bytes;
+    double start = timer_now();
+    int status = parse_ratings_file_keys(filename, num_threads, &triples, &count,
+                                         users, items, &bytes);
+    double parsed = timer_now();
+
+    if (status == 0) {
+        status = remap_keys(triples, &count, users, items, max_items);
+    }
+    if (status == 0) {
+        status = rating_store_build_sized(rs, triples, count, users->count, items->count);
+    }
+    free(triples);
+
+    if (status != 0) {
+        id_map_free(users);
+        id_map_free(items);
+        free(users);
+        free(items);
+        return -1;
+    }
+    rs->user_ids = users;
+    rs->item_ids = items;
+
+    if (stats) {
+        stats->parse_seconds = parsed - start;
+        stats->build_seconds = timer_now() - parsed;
+        stats->bytes = bytes;
+        stats->threads = num_threads;
+    }
+    return 0;
+}
+
+float rating_store_get(const RatingStore *rs, int user, int item) {
+    if (user < 0 || user >= rs->num_users) {
+        return 0.0f;
+    }
+
+    // Busca binária na linha CSR do usuário
+    int lo = rs->user_ptr[user];
+    int hi = rs->user_ptr[user + 1];
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (rs->user_items[mid] < item) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    if (lo < rs->user_ptr[user + 1] && rs->user_items[lo] == item) {
+        return rs->user_ratings[lo];
+    }
+    return 0.0f;
+}
+
+void rating_store_free(RatingStore *rs) {
+    free(rs->user_ptr);
+    free(rs->user_items);
+    free(rs->user_ratings);
+    free(rs->item_ptr);
+    free(rs->item_users);
+    free(rs->item_ratings);
+    if (rs->user_ids) id_map_free(rs->user_ids);
+    if (rs->item_ids) id_map_free(rs->item_ids);
+    free(rs->user_ids);
+    free(rs->item_ids);
+    memset(rs, 0, sizeof(*rs));
+}
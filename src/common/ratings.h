@@ -0,0 +1,97 @@
+/**
+ * Armazenamento esparso de avaliações (compartilhado por todas as versões)
+ *
+ * As avaliações são mantidas em duas visões construídas uma única vez:
+ *   - CSR (por usuário): itens avaliados por cada usuário, ordenados por item
+ *   - CSC (por item): usuários que avaliaram cada item, ordenados por usuário
+ *
+ * Substitui a antiga matriz densa ratings_matrix[MAX_USERS][MAX_ITEMS].
+ */
+
+#ifndef RATINGS_H
+#define RATINGS_H
+
+#include "idmap.h"
+
+typedef struct {
+    int user_id;
+    int item_id;
+    float rating;
+} Rating;
+
+typedef struct {
+    int num_users;
+    int num_items;
+    int num_ratings;
+
+    // Visão CSR (usuário -> itens)
+    int *user_ptr;        // num_users + 1
+    int *user_items;      // num_ratings
+    float *user_ratings;  // num_ratings
+
+    // Visão CSC (item -> usuários)
+    int *item_ptr;        // num_items + 1
+    int *item_users;      // num_ratings
+    float *item_ratings;  // num_ratings
+
+    // IDs externos (--remap-ids, idmap.h); NULL: o índice é o próprio ID
+    IdMap *user_ids;      // num_users chaves
+    IdMap *item_ids;      // num_items chaves
+} RatingStore;
+
+/**
+ * Tempos por etapa da carga (segundos de relógio de parede)
+ */
+typedef struct {
+    double parse_seconds;   // leitura/tokenização do arquivo
+    double build_seconds;   // ordenação e montagem das visões CSR/CSC
+    long long bytes;
+    int threads;
+} LoadStats;
+
+/**
+ * Lê triplas "user_id item_id rating" de um arquivo texto e constrói o store.
+ * Itens com ID >= max_items são descartados (max_items <= 0: sem limite).
+ * A leitura usa num_threads threads (parser.h); stats pode ser NULL.
+ * Arquivos no formato binário (ratings_binary.h) são detectados pelo
+ * número mágico e decodificados diretamente.
+ */
+int rating_store_load(RatingStore *rs, const char *filename, int max_items,
+                      int num_threads, LoadStats *stats);
+
+/**
+ * Como rating_store_load(), com IDs externos quaisquer (idmap.h): usuários
+ * e itens recebem índices densos na ordem canônica das chaves e o store
+ * guarda os dois dicionários. num_users/num_items passam a ser o número
+ * de IDs distintos; max_items > 0 limita os itens distintos (os de maior
+ * chave são descartados). Só para arquivos texto.
+ */
+int rating_store_load_keys(RatingStore *rs, const char *filename, int max_items,
+                           int num_threads, LoadStats *stats);
+
+/**
+ * Constrói as visões CSR/CSC a partir de um vetor de triplas.
+ * Triplas repetidas mantêm a última ocorrência; notas <= 0 são ignoradas.
+ */
+int rating_store_build(RatingStore *rs, Rating *triples, int count);
+
+/**
+ * Como rating_store_build(), com pelo menos num_users usuários e num_items
+ * itens (um processo que recebe só parte das triplas usa as dimensões globais)
+ */
+int rating_store_build_sized(RatingStore *rs, Rating *triples, int count,
+                             int num_users, int num_items);
+
+/**
+ * (Re)constrói a visão CSC a partir da visão CSR já preenchida
+ */
+int rating_store_build_csc(RatingStore *rs);
+
+/**
+ * Retorna a nota do usuário para o item (0 se não avaliado)
+ */
+float rating_store_get(const RatingStore *rs, int user, int item);
+
+void rating_store_free(RatingStore *rs);
+
+#endif
@@ -0,0 +1,247 @@
+/**
+ * Formato binário compacto de avaliações - codificação varint/delta
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "ratings_binary.h"
+
+/**
+ * Varint LEB128: 7 bits por byte, bit alto indica continuação
+ */
+static size_t put_varint(uint8_t *out, uint32_t value) {
+    size_t n = 0;
+    while (value >= 0x80) {
+        out[n++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[n++] = (uint8_t)value;
+    return n;
+}
+
+static const uint8_t *get_varint(const uint8_t *p, const uint8_t *end, uint32_t *value) {
+    uint32_t result = 0;
+    int shift = 0;
+    while (p < end && shift < 35) {
+        uint8_t byte = *p++;
+        result |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return p;
+        }
+        shift += 7;
+    }
+    return NULL;
+}
+
+int ratings_binary_detect(const char *filename) {
+    char magic[8];
+    FILE *file = fopen(filename, "rb");
+    if (!file) {
+        return 0;
+    }
+    int match = fread(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+                memcmp(magic, RATINGS_BINARY_MAGIC, sizeof(RATINGS_BINARY_MAGIC)) == 0;
+    fclose(file);
+    return match;
+}
+
+int ratings_binary_save(const char *filename, const RatingStore *rs) {
+    int nnz = rs->num_ratings;
+    uint8_t *users = malloc((size_t)rs->num_users * 10 + 1);
+    uint8_t *items = malloc((size_t)nnz * 5 + 1);
+    uint8_t *stars = malloc(nnz > 0 ? nnz : 1);
+    if (!users || !items || !stars) {
+        fprintf(stderr, "Erro: memória insuficiente para converter avaliações\n");
+        free(users);
+        free(items);
+        free(stars);
+        return -1;
+    }
+
+    RatingsBinaryHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, RATINGS_BINARY_MAGIC, sizeof(RATINGS_BINARY_MAGIC));
+    header.version = RATINGS_BINARY_VERSION;
+    header.num_users = rs->num_users;
+    header.num_items = rs->num_items;
+    header.num_ratings = nnz;
+
+    int inexact = 0;
+    int prev_user = 0;
+    for (int u = 0; u < rs->num_users; u++) {
+        int start = rs->user_ptr[u];
+        int end = rs->user_ptr[u + 1];
+        if (start == end) continue;
+
+        header.users_bytes += put_varint(users + header.users_bytes, u - prev_user);
+        header.users_bytes += put_varint(users + header.users_bytes, end - start);
+        header.num_rows++;
+        prev_user = u;
+
+        int prev_item = 0;
+        for (int k = start; k < end; k++) {
+            header.items_bytes += put_varint(items + header.items_bytes,
+                                             rs->user_items[k] - prev_item);
+            prev_item = rs->user_items[k];
+
+            float half_stars = rs->user_ratings[k] * 2.0f;
+            if (half_stars < 1.0f || half_stars > 255.0f || half_stars != (int)half_stars) {
+                inexact++;
+            }
+            stars[k] = (uint8_t)half_stars;
+        }
+    }
+
+    int status = 0;
+    if (inexact > 0) {
+        fprintf(stderr, "Erro: %d notas não são múltiplos de 0.5 em (0, 127.5]\n", inexact);
+        status = -1;
+    } else {
+        FILE *file = fopen(filename, "wb");
+        if (!file) {
+            fprintf(stderr, "Erro ao criar arquivo: %s\n", filename);
+            status = -1;
+        } else {
+            if (fwrite(&header, sizeof(header), 1, file) != 1 ||
+                fwrite(users, 1, header.users_bytes, file) != header.users_bytes ||
+                fwrite(items, 1, header.items_bytes, file) != header.items_bytes ||
+                fwrite(stars, 1, nnz, file) != (size_t)nnz) {
+                status = -1;
+            }
+            if (fclose(file) != 0 || status != 0) {
+                fprintf(stderr, "Erro ao gravar arquivo: %s\n", filename);
+                status = -1;
+            }
+        }
+    }
+
+    free(users);
+    free(items);
+    free(stars);
+    return status;
+}
+
+int ratings_binary_load(RatingStore *rs, const char *filename, int max_items) {
+    memset(rs, 0, sizeof(*rs));
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Erro ao abrir arquivo: %s\n", filename);
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(RatingsBinaryHeader)) {
+        fprintf(stderr, "Arquivo binário inválido: %s\n", filename);
+        close(fd);
+        return -1;
+    }
+    const uint8_t *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        fprintf(stderr, "Erro no mmap de %s\n", filename);
+        return -1;
+    }
+
+    const RatingsBinaryHeader *header = (const RatingsBinaryHeader *)data;
+    uint64_t body = (uint64_t)st.st_size - sizeof(RatingsBinaryHeader);
+    if (header->version != RATINGS_BINARY_VERSION || header->num_ratings < 0 ||
+        header->num_users < 0 || header->num_items < 0 || header->num_rows < 0 ||
+        header->users_bytes > body || header->items_bytes > body - header->users_bytes ||
+        (uint64_t)header->num_ratings != body - header->users_bytes - header->items_bytes) {
+        fprintf(stderr, "Arquivo binário com versão %u não suportada ou truncado: %s\n",
+                header->version, filename);
+        munmap((void *)data, st.st_size);
+        return -1;
+    }
+
+    const uint8_t *users = data + sizeof(RatingsBinaryHeader);
+    const uint8_t *items = users + header->users_bytes;
+    const uint8_t *stars = items + header->items_bytes;
+    int nnz = header->num_ratings;
+    int header_items = header->num_items;
+    rs->num_users = header->num_users;
+    rs->user_ptr = calloc(rs->num_users + 1, sizeof(int));
+    rs->user_items = malloc((nnz > 0 ? nnz : 1) * sizeof(int));
+    rs->user_ratings = malloc((nnz > 0 ? nnz : 1) * sizeof(float));
+    if (!rs->user_ptr || !rs->user_items || !rs->user_ratings) {
+        fprintf(stderr, "Erro: memória insuficiente para o armazenamento esparso\n");
+        munmap((void *)data, st.st_size);
+        rating_store_free(rs);
+        return -1;
+    }
+
+    // Decodificação linear direto para a visão CSR
+    const uint8_t *p_user = users;
+    const uint8_t *p_item = items;
+    int user = 0;
+    int next_user = 0;
+    int kept = 0;
+    int read = 0;
+    int skipped = 0;
+    int bad_id = 0;
+    for (int row = 0; row < header->num_rows; row++) {
+        uint32_t delta, count;
+        if (!(p_user = get_varint(p_user, items, &delta)) ||
+            !(p_user = get_varint(p_user, items, &count)) ||
+            (uint64_t)read + count > (uint64_t)nnz || user + (int64_t)delta >= rs->num_users) {
+            break;
+        }
+        user += delta;
+        while (next_user <= user) {
+            rs->user_ptr[next_user++] = kept;
+        }
+
+        uint32_t item = 0;
+        for (uint32_t c = 0; c < count; c++, read++) {
+            uint32_t item_delta;
+            if (!(p_item = get_varint(p_item, stars, &item_delta))) {
+                break;
+            }
+            // IDs estritamente crescentes na linha e abaixo de num_items do
+            // cabeçalho (que cabe em int); senão o arquivo está corrompido
+            if ((c > 0 && item_delta == 0) || item_delta >= (uint32_t)header_items - item ||
+                stars[read] == 0) {
+                bad_id = 1;
+                break;
+            }
+            item += item_delta;
+            if (max_items > 0 && item >= (uint32_t)max_items) {
+                skipped++;
+                continue;
+            }
+            rs->user_items[kept] = item;
+            rs->user_ratings[kept] = stars[read] * 0.5f;
+            if ((int)item >= rs->num_items) rs->num_items = item + 1;
+            kept++;
+        }
+        if (!p_item || bad_id) {
+            break;
+        }
+    }
+    int corrupt = !p_user || !p_item || bad_id || read != nnz;
+    while (next_user <= rs->num_users) {
+        rs->user_ptr[next_user++] = kept;
+    }
+    rs->num_ratings = kept;
+    munmap((void *)data, st.st_size);
+
+    if (corrupt) {
+        fprintf(stderr, "Arquivo binário corrompido: %s\n", filename);
+        rating_store_free(rs);
+        return -1;
+    }
+    if (skipped > 0) {
+        fprintf(stderr, "Aviso: %d avaliações com ID fora do limite ignoradas\n", skipped);
+    }
+    if (max_items <= 0 || header_items <= max_items) {
+        rs->num_items = header_items;
+    }
+
+    return rating_store_build_csc(rs);
+}
@@ -0,0 +1,51 @@
+/**
+ * Formato binário compacto de avaliações
+ *
+ * Arquivo colunar, ordenado por (usuário, item):
+ *   cabeçalho | usuários | itens | notas
+ * - usuários: por usuário com avaliações, varint(delta do ID) e varint(nº de itens)
+ * - itens: varint(delta do ID) dentro de cada usuário
+ * - notas: um byte por avaliação, em meias estrelas (nota * 2)
+ *
+ * O arquivo já guarda a visão CSR sem duplicatas, então a carga é uma
+ * decodificação linear sem ordenação. rating_store_load() reconhece o
+ * formato pelo número mágico.
+ */
+
+#ifndef RATINGS_BINARY_H
+#define RATINGS_BINARY_H
+
+#include <stdint.h>
+#include "ratings.h"
+
+#define RATINGS_BINARY_MAGIC "RECRATE"
+#define RATINGS_BINARY_VERSION 1
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    int32_t num_users;
+    int32_t num_items;
+    int32_t num_ratings;
+    int32_t num_rows;        // usuários com pelo menos uma avaliação
+    uint32_t reserved;
+    uint64_t users_bytes;
+    uint64_t items_bytes;
+} RatingsBinaryHeader;
+
+/**
+ * Verifica o número mágico no início do arquivo
+ */
+int ratings_binary_detect(const char *filename);
+
+/**
+ * Grava o store; falha se alguma nota não for múltiplo de 0.5 em (0, 127.5]
+ */
+int ratings_binary_save(const char *filename, const RatingStore *rs);
+
+/**
+ * Lê um arquivo binário (mmap) e constrói as visões CSR/CSC
+ */
+int ratings_binary_load(RatingStore *rs, const char *filename, int max_items);
+
+#endif
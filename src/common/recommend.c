@@ -0,0 +1,313 @@
+/**
+ * Recomendações em lote - pontuação por faixa de usuários e saída CSV
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <ctype.h>
+#include "recommend.h"
+
+int recommend_scratch_init(RecommendScratch *scratch, int num_items) {
+    int n = num_items > 0 ? num_items : 1;
+    scratch->predictions = malloc(n * sizeof(float));
+    scratch->similarity_sum = malloc(n * sizeof(float));
+    if (!scratch->predictions || !scratch->similarity_sum) {
+        fprintf(stderr, "Erro: memória insuficiente para pontuar %d itens\n", num_items);
+        recommend_scratch_free(scratch);
+        return -1;
+    }
+    return 0;
+}
+
+void recommend_scratch_free(RecommendScratch *scratch) {
+    free(scratch->predictions);
+    free(scratch->similarity_sum);
+    memset(scratch, 0, sizeof(*scratch));
+}
+
+/**
+ * Predições a partir do triângulo da matriz densa: soma sobre os itens
+ * avaliados pelo usuário, em ordem de item
+ */
+static void dense_predictions(const Scorer *scorer, int user, float *predictions) {
+    const RatingStore *rs = scorer->ratings;
+    memset(predictions, 0, scorer->num_items * sizeof(float));
+
+    int row_start = user < rs->num_users ? rs->user_ptr[user] : 0;
+    int row_end = user < rs->num_users ? rs->user_ptr[user + 1] : 0;
+
+    for (int target_item = 0; target_item < scorer->num_items; target_item++) {
+        if (rating_store_get(rs, user, target_item) > 0) {
+            continue;
+        }
+
+        float weighted_sum = 0.0;
+        float similarity_sum = 0.0;
+        for (int k = row_start; k < row_end; k++) {
+            float sim = packed_triangle_get(scorer->triangle, target_item, rs->user_items[k]);
+            weighted_sum += sim * rs->user_ratings[k];
+            similarity_sum += fabs(sim);
+        }
+
+        if (similarity_sum > 0) {
+            predictions[target_item] = weighted_sum / similarity_sum;
+        }
+    }
+}
+
+int recommend_user(const Scorer *scorer, int user, int top_n,
+                   RecommendScratch *scratch, ItemSimilarity *out) {
+    float *predictions = scratch->predictions;
+
+    if (scorer->neighbors) {
+        neighbor_index_predict(scorer->neighbors, scorer->ratings, user,
+                               predictions, scratch->similarity_sum);
+    } else {
+        dense_predictions(scorer, user, predictions);
+    }
+
+    // Seleção parcial: só os top_n melhores, sem ordenar todos os candidatos
+    int count = 0;
+    for (int i = 0; i < scorer->num_items; i++) {
+        if (predictions[i] > 0) {
+            ItemSimilarity candidate = { i, predictions[i] };
+            topk_push(out, &count, top_n, candidate);
+        }
+    }
+    topk_sort(out, count);
+    return count;
+}
+
+/**
+ * Adiciona um ID ao vetor, dobrando a capacidade quando necessário
+ */
+static int append_user(RecommendBatch *batch, int *capacity, int user) {
+    if (batch->num_users == *capacity) {
+        int grown_capacity = *capacity > 0 ? *capacity * 2 : 64;
+        int *grown = realloc(batch->users, grown_capacity * sizeof(int));
+        if (!grown) {
+            return -1;
+        }
+        batch->users = grown;
+        *capacity = grown_capacity;
+    }
+    batch->users[batch->num_users++] = user;
+    return 0;
+}
+
+/**
+ * Adiciona os IDs externos de `text`, separados por espaços ou vírgulas,
+ * traduzidos pelo dicionário; chaves fora dele são contadas em *unknown
+ * (a primeira copiada em first_unknown) e puladas
+ */
+static int append_keys(RecommendBatch *batch, int *capacity, const char *text, int *unknown,
+                       char *first_unknown, size_t first_size) {
+    const char *p = text;
+    while (*p) {
+        while (*p && (isspace((unsigned char)*p) || *p == ',')) p++;
+        const char *start = p;
+        while (*p && !isspace((unsigned char)*p) && *p != ',') p++;
+        if (p == start) {
+            break;
+        }
+        int user = id_map_find(batch->user_ids, start, p - start);
+        if (user < 0) {
+            if ((*unknown)++ == 0) {
+                snprintf(first_unknown, first_size, "%.*s", (int)(p - start), start);
+            }
+        } else if (append_user(batch, capacity, user) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Conteúdo do arquivo, terminado em '\0' (NULL se não abrir)
+ */
+static char *read_text(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return NULL;
+    }
+    size_t size = 0, capacity = 4096;
+    char *text = malloc(capacity);
+    size_t got;
+    while (text && (got = fread(text + size, 1, capacity - size - 1, file)) > 0) {
+        size += got;
+        if (size + 1 == capacity) {
+            char *grown = realloc(text, capacity * 2);
+            if (!grown) {
+                free(text);
+                text = NULL;
+                break;
+            }
+            text = grown;
+            capacity *= 2;
+        }
+    }
+    fclose(file);
+    if (text) text[size] = '\0';
+    return text;
+}
+
+int recommend_batch_init(RecommendBatch *batch, const char *spec, const RatingStore *rs,
+                         int top_n) {
+    memset(batch, 0, sizeof(*batch));
+    batch->top_n = top_n;
+    batch->user_ids = rs->user_ids;
+    batch->item_ids = rs->item_ids;
+    int num_users = rs->num_users;
+
+    int capacity = 0;
+    int status = 0;
+    FILE *file;
+    if (strcmp(spec, "all") == 0) {
+        for (int u = 0; u < num_users && status == 0; u++) {
+            status = append_user(batch, &capacity, u);
+        }
+    } else if (batch->user_ids) {
+        // IDs externos: o arquivo (se existir) ou a própria lista
+        char *text = read_text(spec);
+        int unknown = 0;
+        char first_unknown[64];
+        status = append_keys(batch, &capacity, text ? text : spec, &unknown, first_unknown,
+                             sizeof(first_unknown));
+        free(text);
+        if (unknown > 0) {
+            fprintf(stderr, "Aviso: ID desconhecido no dicionário do modelo: %s (%d IDs ignorados)\n",
+                    first_unknown, unknown);
+        }
+    } else if ((file = fopen(spec, "r")) != NULL) {
+        int user;
+        while (status == 0 && fscanf(file, "%d", &user) == 1) {
+            status = user < 0 ? -2 : append_user(batch, &capacity, user);
+        }
+        fclose(file);
+    } else {
+        const char *p = spec;
+        char *end;
+        while (status == 0 && *p) {
+            long user = strtol(p, &end, 10);
+            if (end == p || user < 0 || (*end != ',' && *end != '\0')) {
+                status = -2;
+                break;
+            }
+            status = append_user(batch, &capacity, (int)user);
+            p = *end == ',' ? end + 1 : end;
+        }
+    }
+
+    if (status == -2) {
+        fprintf(stderr, "Lista de usuários inválida: %s\n", spec);
+        recommend_batch_free(batch);
+        return -1;
+    }
+
+    int n = batch->num_users > 0 ? batch->num_users : 1;
+    batch->count = calloc(n, sizeof(int));
+    batch->items = malloc((size_t)n * (top_n > 0 ? top_n : 1) * sizeof(ItemSimilarity));
+    if (status != 0 || !batch->count || !batch->items) {
+        fprintf(stderr, "Erro: memória insuficiente para o lote de usuários\n");
+        recommend_batch_free(batch);
+        return -1;
+    }
+    return 0;
+}
+
+void recommend_batch_free(RecommendBatch *batch) {
+    free(batch->users);
+    free(batch->count);
+    free(batch->items);
+    memset(batch, 0, sizeof(*batch));
+}
+
+void recommend_batch_range(const Scorer *scorer, RecommendBatch *batch, int begin, int end,
+                           RecommendScratch *scratch) {
+    for (int u = begin; u < end; u++) {
+        batch->count[u] = recommend_user(scorer, batch->users[u], batch->top_n, scratch,
+                                         batch->items + (size_t)u * batch->top_n);
+    }
+}
+
+/**
+ * Custo estimado de pontuar um usuário: a varredura dos itens (1) mais as
+ * avaliações dele
+ */
+static long long user_cost(const RatingStore *rs, int user) {
+    return 1 + (user < rs->num_users ? rs->user_ptr[user + 1] - rs->user_ptr[user] : 0);
+}
+
+void recommend_batch_split(const RecommendBatch *batch, const RatingStore *rs, int parts,
+                           int *bounds) {
+    long long total = 0;
+    for (int u = 0; u < batch->num_users; u++) {
+        total += user_cost(rs, batch->users[u]);
+    }
+
+    // Corta quando o custo acumulado passa da fração p / parts do total
+    long long acc = 0;
+    int u = 0;
+    bounds[0] = 0;
+    for (int p = 1; p < parts; p++) {
+        long long target = total * p / parts;
+        while (u < batch->num_users && acc < target) {
+            acc += user_cost(rs, batch->users[u++]);
+        }
+        bounds[p] = u;
+    }
+    bounds[parts] = batch->num_users;
+}
+
+/**
+ * Campo de ID do CSV: o índice ou a chave externa, entre aspas se tiver
+ * vírgula ou aspas
+ */
+static int print_id(FILE *file, const IdMap *ids, int id) {
+    if (!ids) {
+        return fprintf(file, "%d", id);
+    }
+    const char *key = id_map_key(ids, id);
+    if (!strpbrk(key, ",\"")) {
+        return fputs(key, file);
+    }
+    if (fputc('"', file) == EOF) return -1;
+    for (const char *c = key; *c; c++) {
+        if ((*c == '"' && fputc('"', file) == EOF) || fputc(*c, file) == EOF) return -1;
+    }
+    return fputc('"', file) == EOF ? -1 : 0;
+}
+
+int recommend_batch_print(FILE *file, const RecommendBatch *batch, int begin, int end) {
+    for (int u = begin; u < end; u++) {
+        const ItemSimilarity *items = batch->items + (size_t)u * batch->top_n;
+        for (int r = 0; r < batch->count[u]; r++) {
+            if (print_id(file, batch->user_ids, batch->users[u]) < 0 ||
+                fprintf(file, ",%d,", r + 1) < 0 ||
+                print_id(file, batch->item_ids, items[r].item_id) < 0 ||
+                fprintf(file, ",%.6f\n", items[r].similarity) < 0) {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+int recommend_batch_write(const RecommendBatch *batch, const char *path) {
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "Erro ao criar arquivo: %s\n", path);
+        return -1;
+    }
+
+    fputs(RECOMMEND_CSV_HEADER, file);
+    int status = recommend_batch_print(file, batch, 0, batch->num_users);
+
+    if (fclose(file) != 0 || status != 0) {
+        fprintf(stderr, "Erro ao gravar arquivo: %s\n", path);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,98 @@
+/**
+ * Recomendações em lote para muitos usuários
+ *
+ * recommend_for_user() das versões atende um usuário por vez e imprime na
+ * saída padrão. No lote, o cálculo das predições é separado da saída: cada
+ * thread pontua uma faixa de usuários com buffers próprios, reutilizados
+ * entre usuários, e os resultados vão para um arquivo CSV
+ * (user_id,rank,item_id,score) gravado na ordem da lista de usuários.
+ */
+
+#ifndef RECOMMEND_H
+#define RECOMMEND_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include "ratings.h"
+#include "neighbors.h"
+#include "triangle.h"
+
+/**
+ * Fonte da similaridade: índice top-K (neighbors != NULL) ou triângulo da
+ * matriz densa
+ */
+typedef struct {
+    const RatingStore *ratings;
+    const NeighborIndex *neighbors;
+    const PackedTriangle *triangle;
+    int num_items;
+} Scorer;
+
+/**
+ * Memória de trabalho de uma thread; não compartilhar
+ */
+typedef struct {
+    float *predictions;
+    float *similarity_sum;
+} RecommendScratch;
+
+/**
+ * Resultado do lote: até top_n itens do usuário users[u] em
+ * items[u * top_n ..], count[u] válidos
+ */
+typedef struct {
+    int num_users;
+    int top_n;
+    int *users;
+    int *count;
+    ItemSimilarity *items;
+    const IdMap *user_ids;  // IDs externos do CSV (NULL: os próprios índices)
+    const IdMap *item_ids;
+} RecommendBatch;
+
+int recommend_scratch_init(RecommendScratch *scratch, int num_items);
+void recommend_scratch_free(RecommendScratch *scratch);
+
+/**
+ * Top-N do usuário em `out` (ordem de topk.h); retorna quantos itens foram
+ * escritos. Usado pelo lote e por recommend_for_user() das versões.
+ */
+int recommend_user(const Scorer *scorer, int user, int top_n,
+                   RecommendScratch *scratch, ItemSimilarity *out);
+
+/**
+ * Lê a lista de usuários: "all" (0 .. num_users - 1), um arquivo com IDs
+ * separados por espaço/linha ou uma lista "3,7,42". Se rs tiver
+ * dicionários (idmap.h), os IDs são chaves externas, traduzidas aqui, e o
+ * CSV sai com as chaves.
+ */
+int recommend_batch_init(RecommendBatch *batch, const char *spec, const RatingStore *rs,
+                         int top_n);
+void recommend_batch_free(RecommendBatch *batch);
+
+/**
+ * Pontua os usuários batch->users[begin .. end - 1]
+ */
+void recommend_batch_range(const Scorer *scorer, RecommendBatch *batch, int begin, int end,
+                           RecommendScratch *scratch);
+
+/**
+ * Divide a lista em `parts` faixas contíguas de custo parecido (o custo de
+ * um usuário cresce com o número de avaliações dele): a faixa p é
+ * batch->users[bounds[p] .. bounds[p + 1] - 1]
+ */
+void recommend_batch_split(const RecommendBatch *batch, const RatingStore *rs, int parts,
+                           int *bounds);
+
+// Primeira linha do CSV do lote
+#define RECOMMEND_CSV_HEADER "user_id,rank,item_id,score\n"
+
+/**
+ * Escreve as linhas dos usuários batch->users[begin .. end - 1], sem o
+ * cabeçalho; recommend_batch_write() grava o lote inteiro
+ */
+int recommend_batch_print(FILE *file, const RecommendBatch *batch, int begin, int end);
+
+int recommend_batch_write(const RecommendBatch *batch, const char *path);
+
+#endif
@@ -0,0 +1,322 @@
+/**
+ * Kernels vetoriais - interseção de listas de usuários e conversão dos
+ * acumuladores em similaridade, em versões escalar, AVX2 e AVX-512
+ */
+
+#include <math.h>
+#include "simd.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_X86 1
+#include <immintrin.h>
+// Com AVX-512 o gcc funde "d += r1 * r2" em FMA, que arredonda uma vez só
+// e mudaria o resultado em relação ao kernel escalar
+#pragma GCC optimize ("fp-contract=off")
+#endif
+
+typedef void (*MergeKernel)(const int *, const float *, int, const int *, const float *, int,
+                            accum_t *, accum_t *, accum_t *);
+typedef void (*FinalizeKernel)(const accum_t *, float *, int);
+
+static SimdLevel active_level = SIMD_SCALAR;
+
+/**
+ * Merge escalar a partir de (p1, p2); também termina as caudas dos kernels
+ * vetoriais
+ */
+static inline void merge_tail(const int *users1, const float *ratings1, int n1, int p1,
+                              const int *users2, const float *ratings2, int n2, int p2,
+                              accum_t *dot, accum_t *norm1, accum_t *norm2) {
+    accum_t d = *dot, s1 = *norm1, s2 = *norm2;
+    while (p1 < n1 && p2 < n2) {
+        int u1 = users1[p1];
+        int u2 = users2[p2];
+        if (u1 < u2) {
+            p1++;
+        } else if (u2 < u1) {
+            p2++;
+        } else {
+            accum_t r1 = ratings1[p1++];
+            accum_t r2 = ratings2[p2++];
+            d += r1 * r2;
+            s1 += r1 * r1;
+            s2 += r2 * r2;
+        }
+    }
+    *dot = d;
+    *norm1 = s1;
+    *norm2 = s2;
+}
+
+static void merge_scalar(const int *users1, const float *ratings1, int n1,
+                         const int *users2, const float *ratings2, int n2,
+                         accum_t *dot, accum_t *norm1, accum_t *norm2) {
+    merge_tail(users1, ratings1, n1, 0, users2, ratings2, n2, 0, dot, norm1, norm2);
+}
+
+/**
+ * Acumuladores intercalados (dot, norm1, norm2), como PairAccum
+ */
+static void finalize_scalar(const accum_t *acc, float *out, int count) {
+    for (int j = 0; j < count; j++) {
+        const accum_t *a = acc + 3 * j;
+        if (a[1] == 0.0 || a[2] == 0.0) {
+            out[j] = 0.0;
+        } else {
+            out[j] = a[0] / (sqrt(a[1]) * sqrt(a[2]));
+        }
+    }
+}
+
+#ifdef SIMD_X86
+
+/**
+ * Interseção em blocos de 8 a partir de (*p1, *p2): compara o bloco de
+ * users1 com as 8 rotações do bloco de users2 e avança o bloco de menor
+ * último elemento. Os pares encontrados saem em ordem crescente de usuário
+ * e são acumulados um a um.
+ */
+__attribute__((target("avx2")))
+static inline void merge_blocks8(const int *users1, const float *ratings1, int n1, int *p1,
+                                 const int *users2, const float *ratings2, int n2, int *p2,
+                                 accum_t *dot, accum_t *norm1, accum_t *norm2) {
+    // Rotações independentes (sem cadeia de dependência entre elas)
+    __m256i rotate[8];
+    for (int k = 0; k < 8; k++) {
+        rotate[k] = _mm256_and_si256(_mm256_add_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+                                                      _mm256_set1_epi32(k)),
+                                     _mm256_set1_epi32(7));
+    }
+    accum_t d = *dot, s1 = *norm1, s2 = *norm2;
+    int i1 = *p1;
+    int i2 = *p2;
+
+    while (i1 + 8 <= n1 && i2 + 8 <= n2) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(users1 + i1));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(users2 + i2));
+        __m256i hits = _mm256_cmpeq_epi32(a, b);
+        for (int k = 1; k < 8; k++) {
+            __m256i r = _mm256_permutevar8x32_epi32(b, rotate[k]);
+            hits = _mm256_or_si256(hits, _mm256_cmpeq_epi32(a, r));
+        }
+
+        unsigned mask = _mm256_movemask_ps(_mm256_castsi256_ps(hits));
+        while (mask) {
+            int k = __builtin_ctz(mask);
+            mask &= mask - 1;
+            __m256i key = _mm256_set1_epi32(users1[i1 + k]);
+            int q = __builtin_ctz(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(b, key))));
+            accum_t r1 = ratings1[i1 + k];
+            accum_t r2 = ratings2[i2 + q];
+            d += r1 * r2;
+            s1 += r1 * r1;
+            s2 += r2 * r2;
+        }
+
+        int last1 = users1[i1 + 7];
+        int last2 = users2[i2 + 7];
+        if (last1 <= last2) i1 += 8;
+        if (last2 <= last1) i2 += 8;
+    }
+
+    *p1 = i1;
+    *p2 = i2;
+    *dot = d;
+    *norm1 = s1;
+    *norm2 = s2;
+}
+
+__attribute__((target("avx2")))
+static void merge_avx2(const int *users1, const float *ratings1, int n1,
+                       const int *users2, const float *ratings2, int n2,
+                       accum_t *dot, accum_t *norm1, accum_t *norm2) {
+    int p1 = 0;
+    int p2 = 0;
+    merge_blocks8(users1, ratings1, n1, &p1, users2, ratings2, n2, &p2, dot, norm1, norm2);
+    merge_tail(users1, ratings1, n1, p1, users2, ratings2, n2, p2, dot, norm1, norm2);
+}
+
+/**
+ * Campos de 4 acumuladores consecutivos, deintercalados e em double
+ */
+__attribute__((target("avx2")))
+static inline void load_accum4(const accum_t *base, __m256d *dot, __m256d *n1, __m256d *n2) {
+    const __m128i stride = _mm_setr_epi32(0, 3, 6, 9);
+#ifdef SIMILARITY_ACCUM_DOUBLE
+    *dot = _mm256_i32gather_pd(base, stride, 8);
+    *n1 = _mm256_i32gather_pd(base + 1, stride, 8);
+    *n2 = _mm256_i32gather_pd(base + 2, stride, 8);
+#else
+    *dot = _mm256_cvtps_pd(_mm_i32gather_ps(base, stride, 4));
+    *n1 = _mm256_cvtps_pd(_mm_i32gather_ps(base + 1, stride, 4));
+    *n2 = _mm256_cvtps_pd(_mm_i32gather_ps(base + 2, stride, 4));
+#endif
+}
+
+/**
+ * 4 acumuladores por iteração, em double, zerando as pistas com norma nula
+ */
+__attribute__((target("avx2")))
+static void finalize_avx2(const accum_t *acc, float *out, int count) {
+    const __m256d zero = _mm256_setzero_pd();
+    int j = 0;
+
+    for (; j + 4 <= count; j += 4) {
+        __m256d d, a, b;
+        load_accum4(acc + 3 * j, &d, &a, &b);
+        __m256d valid = _mm256_and_pd(_mm256_cmp_pd(a, zero, _CMP_NEQ_UQ),
+                                      _mm256_cmp_pd(b, zero, _CMP_NEQ_UQ));
+        __m256d sim = _mm256_div_pd(d, _mm256_mul_pd(_mm256_sqrt_pd(a), _mm256_sqrt_pd(b)));
+        _mm_storeu_ps(out + j, _mm256_cvtpd_ps(_mm256_and_pd(sim, valid)));
+    }
+    finalize_scalar(acc + 3 * j, out + j, count - j);
+}
+
+/**
+ * Como merge_avx2(), em blocos de 16
+ */
+__attribute__((target("avx512f")))
+static void merge_avx512(const int *users1, const float *ratings1, int n1,
+                         const int *users2, const float *ratings2, int n2,
+                         accum_t *dot, accum_t *norm1, accum_t *norm2) {
+    __m512i rotate[16];
+    for (int k = 0; k < 16; k++) {
+        rotate[k] = _mm512_and_si512(_mm512_add_epi32(_mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8,
+                                                                        9, 10, 11, 12, 13, 14, 15),
+                                                      _mm512_set1_epi32(k)),
+                                     _mm512_set1_epi32(15));
+    }
+    accum_t d = *dot, s1 = *norm1, s2 = *norm2;
+    int p1 = 0;
+    int p2 = 0;
+
+    while (p1 + 16 <= n1 && p2 + 16 <= n2) {
+        __m512i a = _mm512_loadu_si512(users1 + p1);
+        __m512i b = _mm512_loadu_si512(users2 + p2);
+        __mmask16 hits = _mm512_cmpeq_epi32_mask(a, b);
+        for (int k = 1; k < 16; k++) {
+            hits |= _mm512_cmpeq_epi32_mask(a, _mm512_permutexvar_epi32(rotate[k], b));
+        }
+
+        unsigned mask = hits;
+        while (mask) {
+            int k = __builtin_ctz(mask);
+            mask &= mask - 1;
+            __m512i key = _mm512_set1_epi32(users1[p1 + k]);
+            int q = __builtin_ctz(_mm512_cmpeq_epi32_mask(b, key));
+            accum_t r1 = ratings1[p1 + k];
+            accum_t r2 = ratings2[p2 + q];
+            d += r1 * r2;
+            s1 += r1 * r1;
+            s2 += r2 * r2;
+        }
+
+        int last1 = users1[p1 + 15];
+        int last2 = users2[p2 + 15];
+        if (last1 <= last2) p1 += 16;
+        if (last2 <= last1) p2 += 16;
+    }
+
+    // O resto em blocos de 8 antes da cauda escalar: listas de poucas
+    // dezenas de usuários deixariam a maior parte para o merge escalar
+    *dot = d;
+    *norm1 = s1;
+    *norm2 = s2;
+    merge_blocks8(users1, ratings1, n1, &p1, users2, ratings2, n2, &p2, dot, norm1, norm2);
+    merge_tail(users1, ratings1, n1, p1, users2, ratings2, n2, p2, dot, norm1, norm2);
+}
+
+/**
+ * Campos de 8 acumuladores consecutivos, deintercalados e em double
+ */
+__attribute__((target("avx512f")))
+static inline void load_accum8(const accum_t *base, __m512d *dot, __m512d *n1, __m512d *n2) {
+    const __m256i stride = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+#ifdef SIMILARITY_ACCUM_DOUBLE
+    *dot = _mm512_i32gather_pd(stride, base, 8);
+    *n1 = _mm512_i32gather_pd(stride, base + 1, 8);
+    *n2 = _mm512_i32gather_pd(stride, base + 2, 8);
+#else
+    *dot = _mm512_cvtps_pd(_mm256_i32gather_ps(base, stride, 4));
+    *n1 = _mm512_cvtps_pd(_mm256_i32gather_ps(base + 1, stride, 4));
+    *n2 = _mm512_cvtps_pd(_mm256_i32gather_ps(base + 2, stride, 4));
+#endif
+}
+
+/**
+ * 8 acumuladores por iteração, em double, com divisão mascarada
+ */
+__attribute__((target("avx512f")))
+static void finalize_avx512(const accum_t *acc, float *out, int count) {
+    const __m512d zero = _mm512_setzero_pd();
+    int j = 0;
+
+    for (; j + 8 <= count; j += 8) {
+        __m512d d, a, b;
+        load_accum8(acc + 3 * j, &d, &a, &b);
+        __mmask8 valid = _mm512_cmp_pd_mask(a, zero, _CMP_NEQ_UQ) &
+                         _mm512_cmp_pd_mask(b, zero, _CMP_NEQ_UQ);
+        __m512d sim = _mm512_maskz_div_pd(valid, d, _mm512_mul_pd(_mm512_sqrt_pd(a), _mm512_sqrt_pd(b)));
+        _mm256_storeu_ps(out + j, _mm512_cvtpd_ps(sim));
+    }
+    finalize_scalar(acc + 3 * j, out + j, count - j);
+}
+
+#endif
+
+static MergeKernel merge_kernel = merge_scalar;
+static FinalizeKernel finalize_kernel = finalize_scalar;
+
+SimdLevel simd_detect(void) {
+#ifdef SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return SIMD_AVX512;
+    if (__builtin_cpu_supports("avx2")) return SIMD_AVX2;
+#endif
+    return SIMD_SCALAR;
+}
+
+int simd_init(SimdLevel requested) {
+    SimdLevel supported = simd_detect();
+    SimdLevel level = requested == SIMD_AUTO ? supported : requested;
+    if (level > supported) {
+        return -1;
+    }
+
+    active_level = level;
+    merge_kernel = merge_scalar;
+    finalize_kernel = finalize_scalar;
+#ifdef SIMD_X86
+    if (level == SIMD_AVX2) {
+        merge_kernel = merge_avx2;
+        finalize_kernel = finalize_avx2;
+    } else if (level == SIMD_AVX512) {
+        merge_kernel = merge_avx512;
+        finalize_kernel = finalize_avx512;
+    }
+#endif
+    return 0;
+}
+
+SimdLevel simd_level(void) {
+    return active_level;
+}
+
+const char *simd_level_name(SimdLevel level) {
+    switch (level) {
+        case SIMD_AVX2: return "avx2";
+        case SIMD_AVX512: return "avx512";
+        case SIMD_SCALAR: return "escalar";
+        default: return "auto";
+    }
+}
+
+void simd_cosine_merge(const int *users1, const float *ratings1, int n1,
+                       const int *users2, const float *ratings2, int n2,
+                       accum_t *dot, accum_t *norm1, accum_t *norm2) {
+    merge_kernel(users1, ratings1, n1, users2, ratings2, n2, dot, norm1, norm2);
+}
+
+void simd_cosine_finalize(const accum_t *acc, float *out, int count) {
+    finalize_kernel(acc, out, count);
+}
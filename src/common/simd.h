@@ -0,0 +1,53 @@
+/**
+ * Kernels vetoriais (AVX2 / AVX-512) com escolha em tempo de execução
+ *
+ * Os kernels são compilados com atributos target, sem exigir -mavx2 no
+ * build inteiro; simd_init() escolhe o melhor nível suportado pela CPU ou
+ * o pedido em --simd. O resultado é o mesmo bit a bit do kernel escalar:
+ * a busca dos usuários comuns é vetorial, mas a acumulação segue a ordem
+ * crescente de usuário, e a conversão em similaridade usa double como
+ * sqrt() de math.h.
+ */
+
+#ifndef SIMD_H
+#define SIMD_H
+
+#include "similarity.h"
+
+typedef enum {
+    SIMD_AUTO = -1,  // melhor nível suportado pela CPU
+    SIMD_SCALAR,
+    SIMD_AVX2,
+    SIMD_AVX512
+} SimdLevel;
+
+/**
+ * Seleciona os kernels; retorna -1 se a CPU não suporta o nível pedido
+ */
+int simd_init(SimdLevel requested);
+
+SimdLevel simd_level(void);
+
+/**
+ * Maior nível suportado pela CPU
+ */
+SimdLevel simd_detect(void);
+
+const char *simd_level_name(SimdLevel level);
+
+/**
+ * Merge de duas listas ordenadas de usuários (sem repetição): soma em
+ * dot/norm1/norm2 os produtos dos usuários comuns
+ */
+void simd_cosine_merge(const int *users1, const float *ratings1, int n1,
+                       const int *users2, const float *ratings2, int n2,
+                       accum_t *dot, accum_t *norm1, accum_t *norm2);
+
+/**
+ * Converte `count` acumuladores intercalados (dot, norm1, norm2), o layout
+ * de PairAccum, em out[j] = dot / (sqrt(norm1) * sqrt(norm2)), ou 0 se uma
+ * das normas for nula
+ */
+void simd_cosine_finalize(const accum_t *acc, float *out, int count);
+
+#endif
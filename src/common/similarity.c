@@ -0,0 +1,99 @@
+/**
+ * Kernels de similaridade entre itens - interseção de listas de usuários
+ *
+ * Cada par custa O(nnz_i + nnz_j) com merge linear, ou
+ * O(nnz_menor * log(nnz_maior)) com busca galopante quando as listas
+ * têm tamanhos muito diferentes.
+ */
+
+#include <math.h>
+#include "similarity.h"
+#include "simd.h"
+
+/**
+ * Primeira posição p em [lo, n) com a[p] >= key (busca exponencial)
+ */
+static int gallop(const int *a, int lo, int n, int key) {
+    if (lo >= n || a[lo] >= key) {
+        return lo;
+    }
+
+    // a[prev] < key; dobra o passo até ultrapassar key
+    int prev = lo;
+    int step = 1;
+    while (lo + step < n && a[lo + step] < key) {
+        prev = lo + step;
+        step <<= 1;
+    }
+
+    int l = prev + 1;
+    int h = lo + step < n ? lo + step : n;
+    while (l < h) {
+        int mid = l + (h - l) / 2;
+        if (a[mid] < key) {
+            l = mid + 1;
+        } else {
+            h = mid;
+        }
+    }
+    return l;
+}
+
+float cosine_sparse(const int *users1, const float *ratings1, int n1,
+                    const int *users2, const float *ratings2, int n2) {
+    accum_t dot_product = 0.0;
+    accum_t norm1 = 0.0;
+    accum_t norm2 = 0.0;
+
+    if (n1 > 0 && n2 > 0) {
+        if ((long)n1 * GALLOP_RATIO < n2) {
+            // Lista 1 bem menor: galopa sobre a lista 2
+            int p2 = 0;
+            for (int p1 = 0; p1 < n1; p1++) {
+                p2 = gallop(users2, p2, n2, users1[p1]);
+                if (p2 == n2) break;
+                if (users2[p2] == users1[p1]) {
+                    accum_t r1 = ratings1[p1];
+                    accum_t r2 = ratings2[p2];
+                    dot_product += r1 * r2;
+                    norm1 += r1 * r1;
+                    norm2 += r2 * r2;
+                }
+            }
+        } else if ((long)n2 * GALLOP_RATIO < n1) {
+            // Lista 2 bem menor: galopa sobre a lista 1
+            int p1 = 0;
+            for (int p2 = 0; p2 < n2; p2++) {
+                p1 = gallop(users1, p1, n1, users2[p2]);
+                if (p1 == n1) break;
+                if (users1[p1] == users2[p2]) {
+                    accum_t r1 = ratings1[p1];
+                    accum_t r2 = ratings2[p2];
+                    dot_product += r1 * r2;
+                    norm1 += r1 * r1;
+                    norm2 += r2 * r2;
+                }
+            }
+        } else {
+            // Merge linear das duas listas ordenadas (vetorial, simd.h)
+            simd_cosine_merge(users1, ratings1, n1, users2, ratings2, n2,
+                              &dot_product, &norm1, &norm2);
+        }
+    }
+
+    if (norm1 == 0.0 || norm2 == 0.0) {
+        return 0.0;
+    }
+
+    return dot_product / (sqrt(norm1) * sqrt(norm2));
+}
+
+float similarity_cosine(const RatingStore *rs, int item1, int item2) {
+    int s1 = rs->item_ptr[item1];
+    int s2 = rs->item_ptr[item2];
+
+    return cosine_sparse(rs->item_users + s1, rs->item_ratings + s1,
+                         rs->item_ptr[item1 + 1] - s1,
+                         rs->item_users + s2, rs->item_ratings + s2,
+                         rs->item_ptr[item2 + 1] - s2);
+}
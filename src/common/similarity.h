@@ -0,0 +1,44 @@
+/**
+ * Kernels de similaridade entre itens sobre o armazenamento esparso
+ */
+
+#ifndef SIMILARITY_H
+#define SIMILARITY_H
+
+#include "ratings.h"
+
+/**
+ * Tipo dos acumuladores de produto interno e normas em todos os motores.
+ * float (padrão) reproduz o laço original; `make ACCUM=double` acumula em
+ * float64, sem a deriva da soma em float quando há muitos usuários.
+ * --accuracy mede a diferença (accuracy.h).
+ */
+#ifdef SIMILARITY_ACCUM_DOUBLE
+typedef double accum_t;
+#define ACCUM_NAME "float64"
+#else
+typedef float accum_t;
+#define ACCUM_NAME "float32"
+#endif
+
+/**
+ * Razão de tamanhos a partir da qual a interseção usa busca galopante
+ * (exponencial) na lista maior em vez do merge linear.
+ */
+#define GALLOP_RATIO 16
+
+/**
+ * Similaridade de cosseno entre duas listas de usuários ordenadas.
+ * As normas consideram apenas usuários que avaliaram os dois itens,
+ * e a acumulação segue a ordem crescente de usuário (mesmo resultado
+ * bit a bit do laço denso original).
+ */
+float cosine_sparse(const int *users1, const float *ratings1, int n1,
+                    const int *users2, const float *ratings2, int n2);
+
+/**
+ * Similaridade de cosseno entre os itens item1 e item2 (colunas CSC)
+ */
+float similarity_cosine(const RatingStore *rs, int item1, int item2);
+
+#endif
@@ -0,0 +1,61 @@
+/**
+ * Seleção parcial dos N melhores itens - heap mínimo limitado
+ */
+
+#include "topk.h"
+
+static void sift_down(ItemSimilarity *heap, int n, int pos) {
+    for (;;) {
+        int child = 2 * pos + 1;
+        if (child >= n) break;
+        if (child + 1 < n && topk_worse(&heap[child + 1], &heap[child])) child++;
+        if (!topk_worse(&heap[child], &heap[pos])) break;
+        ItemSimilarity tmp = heap[pos];
+        heap[pos] = heap[child];
+        heap[child] = tmp;
+        pos = child;
+    }
+}
+
+static void sift_up(ItemSimilarity *heap, int pos) {
+    while (pos > 0) {
+        int parent = (pos - 1) / 2;
+        if (!topk_worse(&heap[pos], &heap[parent])) break;
+        ItemSimilarity tmp = heap[pos];
+        heap[pos] = heap[parent];
+        heap[parent] = tmp;
+        pos = parent;
+    }
+}
+
+int topk_push(ItemSimilarity *heap, int *count, int k, ItemSimilarity candidate) {
+    int n = *count;
+
+    if (n < k) {
+        heap[n] = candidate;
+        sift_up(heap, n);
+        *count = n + 1;
+        return 1;
+    }
+    if (k > 0 && topk_worse(&heap[0], &candidate)) {
+        heap[0] = candidate;
+        sift_down(heap, n, 0);
+        return 1;
+    }
+    return 0;
+}
+
+void topk_sort(ItemSimilarity *items, int count) {
+    // Garante a propriedade de heap (vetores já ordenados ao contrário, p.ex.)
+    for (int pos = count / 2 - 1; pos >= 0; pos--) {
+        sift_down(items, count, pos);
+    }
+
+    // Move o pior restante para o fim: sobra a ordem do melhor para o pior
+    for (int n = count - 1; n > 0; n--) {
+        ItemSimilarity tmp = items[0];
+        items[0] = items[n];
+        items[n] = tmp;
+        sift_down(items, n, 0);
+    }
+}
@@ -0,0 +1,40 @@
+/**
+ * Seleção parcial dos N melhores itens (heap mínimo limitado)
+ *
+ * Usado tanto no top-N de recomendações por usuário quanto nas listas
+ * top-K de vizinhos por item: O(n log N) no pior caso, e O(1) para
+ * descartar um candidato pior que o pior guardado, em vez de ordenar
+ * todos os n candidatos.
+ *
+ * Ordem: maior score primeiro; no empate, menor item_id primeiro.
+ */
+
+#ifndef TOPK_H
+#define TOPK_H
+
+typedef struct {
+    int item_id;
+    float similarity;   // similaridade ou score da predição
+} ItemSimilarity;
+
+/**
+ * a é pior que b: menor score ou, no empate, maior item_id
+ */
+static inline int topk_worse(const ItemSimilarity *a, const ItemSimilarity *b) {
+    if (a->similarity != b->similarity) return a->similarity < b->similarity;
+    return a->item_id > b->item_id;
+}
+
+/**
+ * Oferece `candidate` ao heap heap[0 .. *count - 1] de capacidade k (o
+ * pior item fica em heap[0]). Retorna 1 se o candidato foi guardado.
+ */
+int topk_push(ItemSimilarity *heap, int *count, int k, ItemSimilarity candidate);
+
+/**
+ * Ordena items[0 .. count - 1] do melhor para o pior (heapsort in place).
+ * Aceita tanto um heap de topk_push quanto um vetor qualquer.
+ */
+void topk_sort(ItemSimilarity *items, int count);
+
+#endif
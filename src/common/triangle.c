@@ -0,0 +1,137 @@
+/**
+ * Matriz de similaridade simétrica empacotada - alocação e redução de precisão
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "triangle.h"
+
+static size_t triangle_count(int n) {
+    return n > 1 ? (size_t)n * (n - 1) / 2 : 0;
+}
+
+int packed_triangle_init(PackedTriangle *tri, int n) {
+    memset(tri, 0, sizeof(*tri));
+    tri->n = n;
+    tri->precision = TRIANGLE_FP32;
+    tri->values = calloc(triangle_count(n) > 0 ? triangle_count(n) : 1, sizeof(float));
+    if (!tri->values) {
+        fprintf(stderr, "Erro: memória insuficiente para o triângulo de %d itens\n", n);
+        return -1;
+    }
+    return 0;
+}
+
+void packed_triangle_free(PackedTriangle *tri) {
+    free(tri->values);
+    free(tri->half);
+    free(tri->quant);
+    memset(tri, 0, sizeof(*tri));
+}
+
+/**
+ * FP32 -> FP16 com arredondamento para o par mais próximo
+ */
+static uint16_t float_to_half(float f) {
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    uint16_t sign = (bits >> 16) & 0x8000;
+    uint32_t magnitude = bits & 0x7fffffff;
+
+    if (magnitude >= 0x7f800000) {
+        return sign | 0x7c00 | (magnitude > 0x7f800000 ? 0x200 : 0);  // inf/NaN
+    }
+    if (magnitude >= 0x477ff000) {
+        return sign | 0x7c00;  // >= 65520 arredonda para infinito
+    }
+
+    uint32_t result, rest, halfway;
+    if (magnitude < 0x38800000) {
+        // Subnormal em FP16 (< 2^-14): mantissa em unidades de 2^-24
+        if (magnitude < 0x33000000) {
+            return sign;
+        }
+        int shift = 126 - (int)(magnitude >> 23);
+        uint32_t mantissa = (magnitude & 0x7fffff) | 0x800000;
+        result = mantissa >> shift;
+        rest = mantissa & ((1u << shift) - 1);
+        halfway = 1u << (shift - 1);
+    } else {
+        // Normal: reajusta o expoente (127 -> 15) e corta 13 bits da mantissa
+        result = (magnitude - 0x38000000) >> 13;
+        rest = magnitude & 0x1fff;
+        halfway = 0x1000;
+    }
+    if (rest > halfway || (rest == halfway && (result & 1))) {
+        result++;
+    }
+    return sign | (uint16_t)result;
+}
+
+static int8_t float_to_quant(float f) {
+    long q = lrintf(f * 127.0f);
+    if (q > 127) q = 127;
+    if (q < -127) q = -127;
+    return (int8_t)q;
+}
+
+int packed_triangle_convert(PackedTriangle *tri, TrianglePrecision precision) {
+    if (precision == tri->precision) {
+        return 0;
+    }
+    if (tri->precision != TRIANGLE_FP32) {
+        fprintf(stderr, "Erro: só triângulos FP32 podem ser convertidos\n");
+        return -1;
+    }
+
+    size_t count = triangle_count(tri->n);
+    void *data = malloc(count > 0 ? packed_triangle_bytes(tri->n, precision) : 1);
+    if (!data) {
+        fprintf(stderr, "Erro: memória insuficiente para o triângulo em %s\n",
+                triangle_precision_name(precision));
+        return -1;
+    }
+
+    if (precision == TRIANGLE_FP16) {
+        tri->half = data;
+        for (size_t k = 0; k < count; k++) {
+            tri->half[k] = float_to_half(tri->values[k]);
+        }
+    } else {
+        tri->quant = data;
+        for (size_t k = 0; k < count; k++) {
+            tri->quant[k] = float_to_quant(tri->values[k]);
+        }
+    }
+
+    free(tri->values);
+    tri->values = NULL;
+    tri->precision = precision;
+    return 0;
+}
+
+const void *packed_triangle_data(const PackedTriangle *tri) {
+    switch (tri->precision) {
+        case TRIANGLE_FP16: return tri->half;
+        case TRIANGLE_INT8: return tri->quant;
+        default: return tri->values;
+    }
+}
+
+size_t packed_triangle_bytes(int n, TrianglePrecision precision) {
+    switch (precision) {
+        case TRIANGLE_FP16: return triangle_count(n) * sizeof(uint16_t);
+        case TRIANGLE_INT8: return triangle_count(n) * sizeof(int8_t);
+        default: return triangle_count(n) * sizeof(float);
+    }
+}
+
+const char *triangle_precision_name(TrianglePrecision precision) {
+    switch (precision) {
+        case TRIANGLE_FP16: return "fp16";
+        case TRIANGLE_INT8: return "int8";
+        default: return "fp32";
+    }
+}
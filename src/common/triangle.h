@@ -0,0 +1,115 @@
+/**
+ * Matriz de similaridade simétrica empacotada (triângulo superior)
+ *
+ * Guarda só os pares (i, j) com i < j, linha a linha:
+ *   linha i = [sim(i, i+1), sim(i, i+2), ..., sim(i, n-1)]
+ * A diagonal vale sempre 1 e não é armazenada. Cada linha do triângulo é
+ * contígua, então uma tarefa dona de um bloco de linhas escreve uma faixa
+ * contígua de memória, e as linhas [a, b) formam um único segmento
+ * (é o que cada processo MPI envia ao processo 0).
+ *
+ * É a forma principal da matriz densa: metade da memória da matriz
+ * completa, e consultada em O(1) por packed_triangle_get(). Depois do
+ * cálculo (sempre em FP32) os valores podem ser reduzidos a FP16 ou a
+ * inteiros de 8 bits (sim ~ q / 127).
+ */
+
+#ifndef TRIANGLE_H
+#define TRIANGLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef enum {
+    TRIANGLE_FP32 = 0,
+    TRIANGLE_FP16 = 1,   // meia precisão IEEE 754
+    TRIANGLE_INT8 = 2    // quantização linear em [-1, 1], passo 1/127
+} TrianglePrecision;
+
+/**
+ * Só o vetor da precisão corrente é não nulo. Um triângulo aberto de um
+ * modelo aponta para as páginas mapeadas e não deve ser liberado.
+ */
+typedef struct {
+    int n;
+    TrianglePrecision precision;
+    float *values;     // FP32: n * (n - 1) / 2
+    uint16_t *half;    // FP16
+    int8_t *quant;     // INT8
+} PackedTriangle;
+
+/**
+ * Início da linha i (= posição do par (i, i + 1)); a linha n fecha o vetor
+ */
+static inline size_t triangle_row_offset(int n, int i) {
+    return (size_t)i * (2 * (size_t)n - i - 1) / 2;
+}
+
+/**
+ * Posição do par (i, j), i < j, no vetor de valores
+ */
+static inline size_t triangle_index(int n, int i, int j) {
+    return triangle_row_offset(n, i) + (j - i - 1);
+}
+
+static inline float triangle_half_to_float(uint16_t h) {
+    uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+    uint32_t exponent = (h >> 10) & 0x1f;
+    uint32_t mantissa = h & 0x3ff;
+    uint32_t bits;
+
+    if (exponent == 0x1f) {
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    } else if (exponent != 0) {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    } else {
+        // Zero ou subnormal: mantissa * 2^-24
+        float f = mantissa * (1.0f / 16777216.0f);
+        return sign ? -f : f;
+    }
+
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+/**
+ * Similaridade do par (i, j) em qualquer ordem; a diagonal vale 1
+ */
+static inline float packed_triangle_get(const PackedTriangle *tri, int i, int j) {
+    if (i == j) return 1.0f;
+    if (i > j) {
+        int tmp = i;
+        i = j;
+        j = tmp;
+    }
+
+    size_t k = triangle_index(tri->n, i, j);
+    switch (tri->precision) {
+        case TRIANGLE_FP16: return triangle_half_to_float(tri->half[k]);
+        case TRIANGLE_INT8: return tri->quant[k] * (1.0f / 127.0f);
+        default: return tri->values[k];
+    }
+}
+
+/**
+ * Aloca um triângulo FP32 zerado de n itens
+ */
+int packed_triangle_init(PackedTriangle *tri, int n);
+void packed_triangle_free(PackedTriangle *tri);
+
+/**
+ * Converte um triângulo FP32 para `precision`, liberando os valores FP32
+ */
+int packed_triangle_convert(PackedTriangle *tri, TrianglePrecision precision);
+
+/**
+ * Vetor de valores da precisão corrente e seu tamanho em bytes
+ */
+const void *packed_triangle_data(const PackedTriangle *tri);
+size_t packed_triangle_bytes(int n, TrianglePrecision precision);
+
+const char *triangle_precision_name(TrianglePrecision precision);
+
+#endif
@@ -2,226 +2,1432 @@
  * Sistema de Recomendação de Produtos - Versão MPI
  * Algoritmo: Filtragem Colaborativa Item-Item com Similaridade de Cosseno
  * 
- * Paralelização usando MPI para memória distribuída.
+ * Paralelização usando MPI para memória distribuída. Compilado com
+ * -fopenmp (alvo hybrid), cada processo também divide seus blocos de
+ * pares entre threads OpenMP (MPI_THREAD_FUNNELED: só a thread principal
+ * chama MPI).
  */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
 #include <string.h>
+#include <limits.h>
 #include <mpi.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "ratings.h"
+#include "parser.h"
+#include "ratings_binary.h"
+#include "similarity.h"
+#include "blocked.h"
+#include "partition.h"
+#include "neighbors.h"
+#include "model.h"
+#include "incremental.h"
+#include "recommend.h"
+#include "accuracy.h"
+#include "lsh.h"
+#include "allpairs.h"
+#include "options.h"
 
-#define MAX_USERS 10000
-#define MAX_ITEMS 10000
 #define MAX_RATINGS 1000000
 #define TOP_K 10
 
-typedef struct {
-    int item_id;
-    float similarity;
-} ItemSimilarity;
-
-float ratings_matrix[MAX_USERS][MAX_ITEMS];
+// Avaliações em formato esparso (visões CSR e CSC)
+RatingStore ratings;
 int num_users = 0;
 int num_items = 0;
 int num_ratings = 0;
 
-float similarity_matrix[MAX_ITEMS][MAX_ITEMS];
+// Avaliações vistas pela similaridade: as próprias ou centradas (--metric)
+MetricInput metric_input;
+const RatingStore *similarity_input = &ratings;
+
+// Matriz de similaridade (triângulo superior empacotado, completo só no processo 0)
+PackedTriangle similarity_triangle;
+
+// Decomposição 2D bloco-cíclica dos pares entre os processos (partition.h)
+PairGrid pair_grid;
+
+// Pares calculados fora do processo 0, bloco a bloco na ordem (p, q) dos
+// blocos do processo, enviados ao processo 0 no final. No processo 0 os
+// pares vão direto para o triângulo.
+float *block_values = NULL;
+
+// Bloco (p, q) de pares do processo e sua posição em block_values
+typedef struct {
+    int p;
+    int q;
+    size_t base;
+} PairBlock;
+
+// Pares candidatos do motor aproximado (--engine=lsh)
+LshCandidates lsh_candidates;
+
+// Motor allpairs: pares com avaliador comum efetivamente calculados
+long long common_pairs = 0;
+
+// Triângulo usado no scoring: o calculado acima ou o de um modelo mapeado
+const PackedTriangle *dense_similarity = &similarity_triangle;
+NeighborIndex neighbors;
 
-int load_ratings(const char *filename) {
-    FILE *file = fopen(filename, "r");
-    if (!file) {
-        fprintf(stderr, "Erro ao abrir arquivo: %s\n", filename);
+Options options;
+
+// Itens afetados pelo delta de uma atualização incremental (--update)
+RatingDelta changes;
+const unsigned char *update_is_row;  // linhas recalculadas (rating_delta_rows)
+
+/**
+ * Threads OpenMP de cada processo (1 na versão só MPI)
+ */
+int rank_threads() {
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+/**
+ * Lê com MPI-IO as linhas do arquivo que começam na faixa de bytes
+ * [size * rank / P, size * (rank + 1) / P). A primeira linha parcial fica
+ * com o processo anterior e a última é completada lendo além da faixa.
+ */
+int read_line_range(const char *filename, int rank, int size,
+                    char **data, size_t *length, long long *file_bytes) {
+    MPI_File fh;
+    MPI_Offset total;
+
+    if (MPI_File_open(MPI_COMM_WORLD, (char *)filename, MPI_MODE_RDONLY, MPI_INFO_NULL,
+                      &fh) != MPI_SUCCESS) {
+        if (rank == 0) {
+            fprintf(stderr, "Erro ao abrir arquivo: %s\n", filename);
+        }
         return -1;
     }
+    MPI_File_get_size(fh, &total);
+    *file_bytes = total;
 
-    memset(ratings_matrix, 0, sizeof(ratings_matrix));
+    MPI_Offset lo = total * rank / size;
+    MPI_Offset hi = total * (rank + 1) / size;
+    MPI_Offset from = lo > 0 ? lo - 1 : 0;   // o byte lo - 1 diz se lo começa uma linha
+    *data = NULL;
+    *length = 0;
+    if (hi <= lo) {
+        MPI_File_close(&fh);
+        return 0;
+    }
 
-    int user, item;
-    float rating;
-    num_users = 0;
-    num_items = 0;
-    num_ratings = 0;
+    // Lê até achar a quebra de linha em hi - 1 ou depois dela (ou o fim do arquivo)
+    size_t capacity = (size_t)(hi - from) + 4096;
+    size_t filled = 0;
+    char *buffer = NULL;
+    size_t end = 0;
+    int found = 0;
+    for (;;) {
+        char *grown = realloc(buffer, capacity);
+        if (!grown) {
+            fprintf(stderr, "Erro: memória insuficiente para a faixa do processo %d\n", rank);
+            free(buffer);
+            MPI_File_close(&fh);
+            return -1;
+        }
+        buffer = grown;
 
-    while (fscanf(file, "%d %d %f", &user, &item, &rating) == 3) {
-        if (user >= MAX_USERS || item >= MAX_ITEMS) {
-            continue;
+        size_t want = capacity - filled;
+        if ((MPI_Offset)(from + filled + want) > total) want = total - from - filled;
+        // A contagem de MPI_File_read_at é int: faixas acima de 2 GB em várias leituras
+        for (size_t done = 0; done < want;) {
+            int chunk = want - done > INT_MAX ? INT_MAX : (int)(want - done);
+            MPI_Status status;
+            MPI_File_read_at(fh, from + filled + done, buffer + filled + done, chunk, MPI_BYTE,
+                             &status);
+            done += chunk;
         }
-        
-        ratings_matrix[user][item] = rating;
-        if (user >= num_users) num_users = user + 1;
-        if (item >= num_items) num_items = item + 1;
-        num_ratings++;
+        filled += want;
+
+        for (end = (size_t)(hi - 1 - from); end < filled && buffer[end] != '\n'; end++) {
+        }
+        found = end < filled;
+        if (found || (MPI_Offset)(from + filled) >= total) break;
+        capacity *= 2;
+    }
+    MPI_File_close(&fh);
+    end = found ? end + 1 : filled;
+
+    size_t begin = 0;
+    if (lo > 0) {
+        while (begin < end && buffer[begin] != '\n') begin++;
+        begin = begin < end ? begin + 1 : end;
+    }
+
+    memmove(buffer, buffer + begin, end - begin);
+    *data = buffer;
+    *length = end - begin;
+    return 0;
+}
+
+/**
+ * Cada processo recebe só as colunas de que precisa: as dos grupos de
+ * itens dos seus blocos de pares (o processo 0 recebe todas, como convém
+ * ao scoring). Um único MPI_Alltoallv troca as triplas; a ordem de
+ * recebimento (processo de origem, posição no arquivo) mantém a regra de
+ * "última ocorrência vence" das duplicatas. As contagens são em triplas
+ * (tipo MPI de uma Rating), não em bytes, e os totais por processo são
+ * conferidos contra INT_MAX, o limite dos deslocamentos do Alltoallv.
+ */
+int exchange_ratings(const Rating *triples, int count, int rank, int size,
+                     Rating **received, int *received_count, long long *sent_bytes) {
+    char *needs = malloc((size_t)pair_grid.num_groups * size);
+    int *send_counts = calloc(size, sizeof(int));
+    int *send_displs = malloc(size * sizeof(int));
+    int *recv_counts = malloc(size * sizeof(int));
+    int *recv_displs = malloc(size * sizeof(int));
+    int *fill = malloc(size * sizeof(int));
+    if (!needs || !send_counts || !send_displs || !recv_counts || !recv_displs || !fill) {
+        fprintf(stderr, "Erro: memória insuficiente para a troca de avaliações\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    for (int g = 0; g < pair_grid.num_groups; g++) {
+        for (int r = 0; r < size; r++) {
+            needs[(size_t)g * size + r] = r == 0 || pair_grid_needs_group(&pair_grid, r, g);
+        }
+    }
+
+    for (int k = 0; k < count; k++) {
+        const char *dest = needs + (size_t)pair_grid_group_of(&pair_grid, triples[k].item_id) * size;
+        for (int r = 0; r < size; r++) {
+            send_counts[r] += dest[r];
+        }
+    }
+    long long send_total = 0;
+    for (int r = 0; r < size; r++) {
+        send_displs[r] = (int)send_total;
+        send_total += send_counts[r];
+    }
+    if (send_total > INT_MAX) {
+        fprintf(stderr, "Erro: o processo %d enviaria %lld avaliações (limite %d)\n",
+                rank, send_total, INT_MAX);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    *sent_bytes = (send_total - send_counts[rank]) * (long long)sizeof(Rating);
+
+    Rating *send = malloc(send_total > 0 ? send_total * sizeof(Rating) : 1);
+    if (!send) {
+        fprintf(stderr, "Erro: memória insuficiente para a troca de avaliações\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    memcpy(fill, send_displs, size * sizeof(int));
+    for (int k = 0; k < count; k++) {
+        const char *dest = needs + (size_t)pair_grid_group_of(&pair_grid, triples[k].item_id) * size;
+        for (int r = 0; r < size; r++) {
+            if (dest[r]) {
+                send[fill[r]++] = triples[k];
+            }
+        }
+    }
+
+    MPI_Alltoall(send_counts, 1, MPI_INT, recv_counts, 1, MPI_INT, MPI_COMM_WORLD);
+    long long recv_total = 0;
+    for (int r = 0; r < size; r++) {
+        recv_displs[r] = (int)recv_total;
+        recv_total += recv_counts[r];
+    }
+    if (recv_total > INT_MAX) {
+        fprintf(stderr, "Erro: o processo %d receberia %lld avaliações (limite %d)\n",
+                rank, recv_total, INT_MAX);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    *received = malloc(recv_total > 0 ? recv_total * sizeof(Rating) : 1);
+    if (!*received) {
+        fprintf(stderr, "Erro: memória insuficiente para a troca de avaliações\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
     }
+    MPI_Datatype rating_type;
+    MPI_Type_contiguous((int)sizeof(Rating), MPI_BYTE, &rating_type);
+    MPI_Type_commit(&rating_type);
+    MPI_Alltoallv(send, send_counts, send_displs, rating_type,
+                  *received, recv_counts, recv_displs, rating_type, MPI_COMM_WORLD);
+    MPI_Type_free(&rating_type);
+    *received_count = (int)recv_total;
 
-    fclose(file);
-    printf("Carregados: %d usuários, %d itens, %d avaliações\n", 
-           num_users, num_items, num_ratings);
+    free(send);
+    free(needs);
+    free(send_counts);
+    free(send_displs);
+    free(recv_counts);
+    free(recv_displs);
+    free(fill);
     return 0;
 }
 
 /**
- * Calcula a similaridade de cosseno entre dois itens
+ * Carga distribuída: cada processo lê e interpreta sua faixa do arquivo
+ * texto (arquivos binários são decodificados pelo processo 0), as
+ * dimensões globais são reduzidas e as triplas trocadas esparsamente.
+ * Substitui a carga no processo 0 seguida do broadcast do CSR completo.
+ */
+int load_ratings(const char *filename, int rank, int size) {
+    Rating *triples = NULL;
+    int count = 0;
+    int skipped = 0;
+    int malformed = 0;
+    long long bytes = 0;
+    int dims[2] = { 0, 0 };
+    int status = 0;
+    int load_threads = options.load_threads > 0 ? options.load_threads : rank_threads();
+    double start = MPI_Wtime();
+
+    int binary = rank == 0 ? ratings_binary_detect(filename) : 0;
+    MPI_Bcast(&binary, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+    if (binary) {
+        // Já ordenado e sem duplicatas: o processo 0 decodifica e reparte
+        RatingStore full;
+        if (rank == 0 && (status = rating_store_load(&full, filename, 0, 1, NULL)) == 0) {
+            count = full.num_ratings;
+            triples = malloc((count > 0 ? count : 1) * sizeof(Rating));
+            if (triples) {
+                for (int u = 0; u < full.num_users; u++) {
+                    for (int k = full.user_ptr[u]; k < full.user_ptr[u + 1]; k++) {
+                        triples[k].user_id = u;
+                        triples[k].item_id = full.user_items[k];
+                        triples[k].rating = full.user_ratings[k];
+                    }
+                }
+            } else {
+                status = -1;
+            }
+            dims[0] = full.num_users;
+            dims[1] = full.num_items;
+            rating_store_free(&full);
+        }
+    } else {
+        char *data;
+        size_t length;
+        status = read_line_range(filename, rank, size, &data, &length, &bytes);
+        if (status == 0) {
+            status = parse_ratings_buffer(data, length, 0, load_threads,
+                                          &triples, &count, &skipped, &malformed);
+            free(data);
+        }
+        if (status != 0 && rank == 0) {
+            fprintf(stderr, "Erro: falha ao ler %s\n", filename);
+        }
+    }
+
+    MPI_Allreduce(MPI_IN_PLACE, &status, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+    if (status != 0) {
+        free(triples);
+        return -1;
+    }
+
+    // Como na leitura serial, nada depois do primeiro token inválido é lido
+    int *stopped = malloc(size * sizeof(int));
+    if (!stopped) {
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    MPI_Allgather(&malformed, 1, MPI_INT, stopped, 1, MPI_INT, MPI_COMM_WORLD);
+    int any_malformed = 0;
+    for (int r = 0; r < size; r++) {
+        if (r < rank && stopped[r]) {
+            count = 0;
+            skipped = 0;
+        }
+        any_malformed |= stopped[r];
+    }
+    free(stopped);
+
+    if (!binary) {
+        for (int k = 0; k < count; k++) {
+            if (triples[k].user_id >= dims[0]) dims[0] = triples[k].user_id + 1;
+            if (triples[k].item_id >= dims[1]) dims[1] = triples[k].item_id + 1;
+        }
+    }
+    MPI_Allreduce(MPI_IN_PLACE, dims, 2, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+    num_users = dims[0];
+    num_items = dims[1];
+    if (pair_grid_init(&pair_grid, num_items, size) != 0) {
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    double parsed = MPI_Wtime();
+
+    Rating *received;
+    int received_count;
+    long long sent_bytes;
+    exchange_ratings(triples, count, rank, size, &received, &received_count, &sent_bytes);
+    free(triples);
+    double exchanged = MPI_Wtime();
+
+    status = rating_store_build_sized(&ratings, received, received_count, num_users, num_items);
+    free(received);
+    MPI_Allreduce(MPI_IN_PLACE, &status, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+    if (status != 0) {
+        return -1;
+    }
+    num_ratings = ratings.num_ratings;   // completo só no processo 0
+    double built = MPI_Wtime();
+
+    long long totals[2] = { sent_bytes, skipped };
+    MPI_Reduce(rank == 0 ? MPI_IN_PLACE : totals, totals, 2, MPI_LONG_LONG, MPI_SUM, 0,
+               MPI_COMM_WORLD);
+
+    if (rank == 0) {
+        if (any_malformed) {
+            fprintf(stderr, "Aviso: leitura interrompida em token inválido em %s\n", filename);
+        }
+        if (totals[1] > 0) {
+            fprintf(stderr, "Aviso: %lld avaliações com ID fora do limite ignoradas\n", totals[1]);
+        }
+
+        // O broadcast do CSR completo levaria user_ptr + itens + notas a cada processo
+        double broadcast_bytes = (double)(size - 1) *
+            ((num_users + 1) * sizeof(int) + (double)num_ratings * (sizeof(int) + sizeof(float)));
+        printf("Carregados: %d usuários, %d itens, %d avaliações\n",
+               num_users, num_items, num_ratings);
+        printf("Tempo de carga: %.4f segundos (leitura %.4f s em %d processos%s, troca %.4f s, construção CSR/CSC %.4f s)\n",
+               built - start, parsed - start, binary ? 1 : size, binary ? "" : " via MPI-IO",
+               exchanged - parsed, built - exchanged);
+        printf("Avaliações distribuídas: %.2f MB trocados (broadcast do CSR: %.2f MB)\n",
+               totals[0] / 1e6, broadcast_bytes / 1e6);
+    }
+    return 0;
+}
+
+/**
+ * Médias e avaliações centradas da métrica, calculadas uma vez antes da
+ * similaridade; as predições continuam usando as notas originais. Só o
+ * processo 0 de comm tem todas as avaliações: ele calcula as médias e as
+ * distribui, e cada processo centra as colunas que recebeu.
+ */
+int prepare_metric(SimilarityMetric metric, MPI_Comm comm) {
+    float *user_mean = NULL;
+    float *item_mean = NULL;
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+
+    if (metric != METRIC_COSINE) {
+        user_mean = malloc((num_users > 0 ? num_users : 1) * sizeof(float));
+        item_mean = malloc((num_items > 0 ? num_items : 1) * sizeof(float));
+        if (!user_mean || !item_mean ||
+            (rank == 0 && metric_means(&ratings, user_mean, item_mean) != 0)) {
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        MPI_Bcast(user_mean, num_users, MPI_FLOAT, 0, comm);
+        MPI_Bcast(item_mean, num_items, MPI_FLOAT, 0, comm);
+    }
+
+    int status = metric_input_init(&metric_input, &ratings, metric, user_mean, item_mean);
+    free(user_mean);
+    free(item_mean);
+    if (status != 0) {
+        return -1;
+    }
+    similarity_input = &metric_input.view;
+    return 0;
+}
+
+/**
+ * Calcula a similaridade de cosseno entre dois itens (sobre as avaliações
+ * centradas com --metric=adjusted|pearson)
  */
 float cosine_similarity(int item1, int item2) {
-    float dot_product = 0.0;
-    float norm1 = 0.0;
-    float norm2 = 0.0;
+    // Interseção das listas de usuários dos dois itens (merge/galope)
+    return similarity_cosine(similarity_input, item1, item2);
+}
 
-    for (int user = 0; user < num_users; user++) {
-        float r1 = ratings_matrix[user][item1];
-        float r2 = ratings_matrix[user][item2];
-        
-        if (r1 > 0 && r2 > 0) {
-            dot_product += r1 * r2;
-            norm1 += r1 * r1;
-            norm2 += r2 * r2;
+/**
+ * Posição do par (i, j) do bloco em block_values: blocos fora da diagonal
+ * são retângulos linha a linha; os da diagonal, triângulos empacotados
+ * como o da matriz
+ */
+size_t block_offset(const PairBlock *block, int i, int j) {
+    int p0 = pair_grid.group_start[block->p];
+    int q0 = pair_grid.group_start[block->q];
+    if (block->p == block->q) {
+        return block->base + triangle_index(pair_grid.group_start[block->p + 1] - p0, i - p0, j - p0);
+    }
+    return block->base + (size_t)(i - p0) * (pair_grid.group_start[block->q + 1] - q0) + (j - q0);
+}
+
+/**
+ * Grava a similaridade do par (i, j), i < j: no modo denso no triângulo
+ * (processo 0) ou no bloco local; no modo top-K o par é oferecido às duas
+ * linhas do índice local
+ */
+void store_similarity(const PairBlock *block, int i, int j, float sim) {
+    if (options.top_k > 0) {
+        neighbor_index_offer(&neighbors, i, j, sim);
+        neighbor_index_offer(&neighbors, j, i, sim);
+    } else if (!block_values) {
+        similarity_triangle.values[triangle_index(num_items, i, j)] = sim;
+    } else {
+        block_values[block_offset(block, i, j)] = sim;
+    }
+}
+
+/**
+ * Grava um segmento de linha calculado pelo motor em blocos (ctx = PairBlock *)
+ */
+void store_similarity_row(int item, int first, const float *sims, int count, void *ctx) {
+    for (int k = 0; k < count; k++) {
+        store_similarity((const PairBlock *)ctx, item, first + k, sims[k]);
+    }
+}
+
+/**
+ * Tipo com `count` elementos contíguos de `element`: a contagem das
+ * chamadas MPI é int, e tanto os blocos de um processo (acima de ~65 mil
+ * itens) quanto as listas top-K (n * K entradas) passam de INT_MAX
+ */
+MPI_Datatype long_run_type(MPI_Datatype element, long long count) {
+    const int chunk = 1 << 30;
+    MPI_Aint lb, extent;
+    MPI_Datatype chunk_type, run_type;
+    MPI_Type_get_extent(element, &lb, &extent);
+    MPI_Type_contiguous(chunk, element, &chunk_type);
+
+    int lengths[2] = { (int)(count / chunk), (int)(count % chunk) };
+    MPI_Aint displs[2] = { 0, (MPI_Aint)(count / chunk) * chunk * extent };
+    MPI_Datatype types[2] = { chunk_type, element };
+    MPI_Type_create_struct(2, lengths, displs, types, &run_type);
+    MPI_Type_commit(&run_type);
+    MPI_Type_free(&chunk_type);
+    return run_type;
+}
+
+/**
+ * Tipo com as listas top-K de todos os itens (num_items * top_k entradas)
+ */
+MPI_Datatype neighbor_entries_type() {
+    MPI_Datatype entry_type;
+    MPI_Type_contiguous((int)sizeof(ItemSimilarity), MPI_BYTE, &entry_type);
+    MPI_Datatype run_type = long_run_type(entry_type, (long long)num_items * options.top_k);
+    MPI_Type_free(&entry_type);
+    return run_type;
+}
+
+/**
+ * Funde no processo 0 os índices top-K parciais de todos os processos.
+ * Um par (i, j) só é calculado pelo dono de min(i, j), então a linha j
+ * pode ter candidatos vindos de vários processos. A fusão é uma árvore
+ * binomial: a cada passo s = 1, 2, 4, ... o processo r com o bit s ligado
+ * envia suas listas a r - s e sai; o processo 0 faz log2(P) fusões em vez
+ * de P - 1, e só listas de K vizinhos trafegam (nunca linhas completas).
+ */
+void reduce_neighbor_index(int rank, int size) {
+    size_t entries_per_rank = (size_t)num_items * options.top_k;
+    MPI_Datatype entries_type = neighbor_entries_type();
+    int *count = NULL;
+    ItemSimilarity *entries = NULL;
+
+    for (int step = 1; step < size; step <<= 1) {
+        if (rank & step) {
+            int dest = rank - step;
+            MPI_Send(neighbors.count, num_items, MPI_INT, dest, 0, MPI_COMM_WORLD);
+            MPI_Send(neighbors.entries, 1, entries_type, dest, 1, MPI_COMM_WORLD);
+            break;
         }
+
+        int src = rank + step;
+        if (src >= size) {
+            continue;
+        }
+        if (!count) {
+            count = malloc(num_items * sizeof(int));
+            entries = malloc(entries_per_rank * sizeof(ItemSimilarity));
+            if (!count || !entries) {
+                fprintf(stderr, "Erro: memória insuficiente para receber vizinhos\n");
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+        }
+        MPI_Recv(count, num_items, MPI_INT, src, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        MPI_Recv(entries, 1, entries_type, src, 1, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        neighbor_index_merge(&neighbors, count, entries);
+    }
+
+    MPI_Type_free(&entries_type);
+    free(count);
+    free(entries);
+    if (rank == 0) {
+        neighbor_index_finalize(&neighbors);
+    }
+}
+
+/**
+ * Junta no processo 0 os blocos de todos os processos. Os pares de um
+ * bloco são, no triângulo, um segmento por linha; para cada origem o
+ * processo 0 descreve esses segmentos com um tipo indexado (deslocamentos
+ * em bytes, MPI_Aint, pois o triângulo passa de INT_MAX valores) e recebe
+ * com MPI_Irecv direto no triângulo, de todas as origens ao mesmo tempo.
+ */
+void gather_similarity_triangle(int rank, int size, long long local_pairs) {
+    if (rank != 0) {
+        MPI_Datatype run_type = long_run_type(MPI_FLOAT, local_pairs);
+        MPI_Send(block_values, 1, run_type, 0, 0, MPI_COMM_WORLD);
+        MPI_Type_free(&run_type);
+        return;
     }
 
-    if (norm1 == 0.0 || norm2 == 0.0) {
-        return 0.0;
+    MPI_Request *requests = malloc(size * sizeof(MPI_Request));
+    MPI_Datatype *types = malloc(size * sizeof(MPI_Datatype));
+    int capacity = num_items > 0 ? num_items : 1;
+    int *lengths = malloc(capacity * sizeof(int));
+    MPI_Aint *displs = malloc(capacity * sizeof(MPI_Aint));
+    if (!requests || !types || !lengths || !displs) {
+        fprintf(stderr, "Erro: memória insuficiente para a coleta do triângulo\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
     }
 
-    return dot_product / (sqrt(norm1) * sqrt(norm2));
+    int G = pair_grid.num_groups;
+    for (int src = 1; src < size; src++) {
+        int segments = 0;
+        for (int p = 0; p < G; p++) {
+            for (int q = p; q < G; q++) {
+                if (pair_grid_owner(&pair_grid, p, q) != src) continue;
+
+                int q0 = pair_grid.group_start[q];
+                int q1 = pair_grid.group_start[q + 1];
+                for (int i = pair_grid.group_start[p]; i < pair_grid.group_start[p + 1]; i++) {
+                    int first = i + 1 > q0 ? i + 1 : q0;
+                    if (first >= q1) continue;
+                    if (segments == capacity) {
+                        capacity *= 2;
+                        lengths = realloc(lengths, capacity * sizeof(int));
+                        displs = realloc(displs, capacity * sizeof(MPI_Aint));
+                        if (!lengths || !displs) {
+                            fprintf(stderr, "Erro: memória insuficiente para a coleta do triângulo\n");
+                            MPI_Abort(MPI_COMM_WORLD, 1);
+                        }
+                    }
+                    lengths[segments] = q1 - first;
+                    displs[segments] = (MPI_Aint)(triangle_index(num_items, i, first) * sizeof(float));
+                    segments++;
+                }
+            }
+        }
+
+        MPI_Type_create_hindexed(segments, lengths, displs, MPI_FLOAT, &types[src]);
+        MPI_Type_commit(&types[src]);
+        MPI_Irecv(similarity_triangle.values, 1, types[src], src, 0, MPI_COMM_WORLD,
+                  &requests[src]);
+    }
+
+    MPI_Waitall(size - 1, requests + 1, MPI_STATUSES_IGNORE);
+    for (int src = 1; src < size; src++) {
+        MPI_Type_free(&types[src]);
+    }
+    free(requests);
+    free(types);
+    free(lengths);
+    free(displs);
+}
+
+/**
+ * Pares por processo e desbalanceamento da decomposição 2D
+ */
+void print_grid_balance(int size) {
+    long long *pairs = calloc(size, sizeof(long long));
+    if (!pairs) {
+        return;
+    }
+    long long total = 0;
+    for (int p = 0; p < pair_grid.num_groups; p++) {
+        for (int q = p; q < pair_grid.num_groups; q++) {
+            long long block = pair_grid_block_pairs(&pair_grid, p, q);
+            pairs[pair_grid_owner(&pair_grid, p, q)] += block;
+            total += block;
+        }
+    }
+
+    long long max_pairs = 0;
+    for (int r = 0; r < size; r++) {
+        if (pairs[r] > max_pairs) max_pairs = pairs[r];
+    }
+    printf("Decomposição 2D: grade de %d linhas x até %d processos, %d grupos de itens\n",
+           pair_grid.rows, pair_grid.cols, pair_grid.num_groups);
+    if (total > 0) {
+        printf("  Desbalanceamento (máx/média de pares): %.3f\n",
+               max_pairs / ((double)total / size));
+    }
+    free(pairs);
+}
+
+/**
+ * Motor aproximado: só o processo 0 tem todas as colunas, então ele gera
+ * os candidatos do LSH e os distribui; cada processo calcula os candidatos
+ * que caem nos seus blocos
+ */
+void share_lsh_candidates(int rank) {
+    double start = MPI_Wtime();
+    int status = 0;
+    if (rank == 0) {
+        status = lsh_candidates_build(similarity_input, &options.lsh, &lsh_candidates);
+    }
+    MPI_Bcast(&status, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if (status != 0) {
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    if (rank != 0) {
+        lsh_candidates.num_items = num_items;
+        lsh_candidates.ptr = malloc((num_items + 1) * sizeof(int));
+        if (!lsh_candidates.ptr) {
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+    MPI_Bcast(lsh_candidates.ptr, num_items + 1, MPI_INT, 0, MPI_COMM_WORLD);
+    int total = lsh_candidates.ptr[num_items];
+    if (rank != 0) {
+        lsh_candidates.num_pairs = total;
+        lsh_candidates.items = malloc((total > 0 ? total : 1) * sizeof(int));
+        if (!lsh_candidates.items) {
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+    MPI_Bcast(lsh_candidates.items, total, MPI_INT, 0, MPI_COMM_WORLD);
+
+    if (rank == 0) {
+        lsh_print_summary(&lsh_candidates, &options.lsh, MPI_Wtime() - start, stdout);
+    }
 }
 
 /**
  * Calcula a matriz de similaridade usando MPI
- * Cada processo calcula um subconjunto de linhas da matriz
+ * Cada processo calcula os blocos de pares (p, q) que a grade 2D lhe
+ * atribui, usando só as colunas dos grupos p e q. Na versão híbrida os
+ * blocos do processo são repartidos entre as threads (schedule dinâmico),
+ * cada uma com seu ladrilho do motor em blocos.
  */
 void compute_similarity_matrix_mpi(int rank, int size) {
-    // Determinar quais itens este processo irá processar
-    int items_per_process = num_items / size;
-    int remainder = num_items % size;
-    
-    int start_item = rank * items_per_process + (rank < remainder ? rank : remainder);
-    int end_item = start_item + items_per_process + (rank < remainder ? 1 : 0);
+    int G = pair_grid.num_groups;
+    long long local_pairs = 0;
+    int local_blocks = 0;
+    int local_items = 0;
+    int num_threads = rank_threads();
+
+    for (int p = 0; p < G; p++) {
+        for (int q = p; q < G; q++) {
+            if (pair_grid_owner(&pair_grid, p, q) == rank) {
+                local_blocks++;
+            }
+        }
+        if (rank == 0 || pair_grid_needs_group(&pair_grid, rank, p)) {
+            local_items += pair_grid.group_start[p + 1] - pair_grid.group_start[p];
+        }
+    }
+
+    PairBlock *blocks = malloc((local_blocks > 0 ? local_blocks : 1) * sizeof(PairBlock));
+    if (!blocks) {
+        fprintf(stderr, "Erro: memória insuficiente para os blocos do processo\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    local_blocks = 0;
+    for (int p = 0; p < G; p++) {
+        for (int q = p; q < G; q++) {
+            if (pair_grid_owner(&pair_grid, p, q) != rank) continue;
+            blocks[local_blocks].p = p;
+            blocks[local_blocks].q = q;
+            blocks[local_blocks].base = local_pairs;
+            local_pairs += pair_grid_block_pairs(&pair_grid, p, q);
+            local_blocks++;
+        }
+    }
     
     if (rank == 0) {
-        printf("Calculando matriz de similaridade com %d processos MPI...\n", size);
+        printf("Calculando matriz de similaridade com %d processos MPI x %d thread(s)...\n",
+               size, num_threads);
+        print_grid_balance(size);
     }
     
-    printf("Processo %d: itens %d até %d\n", rank, start_item, end_item - 1);
+    printf("Processo %d: %d blocos, %lld pares, %d itens locais\n",
+           rank, local_blocks, local_pairs, local_items);
     
-    // Calcular similaridades para a faixa deste processo
-    for (int i = start_item; i < end_item && i < num_items; i++) {
-        similarity_matrix[i][i] = 1.0;
-        
-        // Triângulo superior (j > i): calcula e armazena
-        for (int j = i + 1; j < num_items; j++) {
-            float sim = cosine_similarity(i, j);
-            similarity_matrix[i][j] = sim;
-            // NÃO preenche [j][i] aqui para evitar race condition!
+    if (options.top_k > 0) {
+        if (neighbor_index_init(&neighbors, num_items, options.top_k, options.min_similarity) != 0) {
+            MPI_Abort(MPI_COMM_WORLD, 1);
         }
-        
-        if ((i + 1) % 100 == 0) {
-            printf("Processo %d: Processado %d/%d itens\n", rank, i + 1, end_item);
+    } else if (rank == 0) {
+        if (packed_triangle_init(&similarity_triangle, num_items) != 0) {
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    } else {
+        block_values = calloc(local_pairs > 0 ? local_pairs : 1, sizeof(float));
+        if (!block_values) {
+            fprintf(stderr, "Erro: memória insuficiente para os blocos do processo\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
         }
     }
-    
-    // Sincronizar todos os processos
-    MPI_Barrier(MPI_COMM_WORLD);
-    
-    // Coletar resultados parciais no processo 0
-    if (rank == 0) {
-        // Processo 0 já tem sua parte calculada
-        for (int src = 1; src < size; src++) {
-            int src_start = src * items_per_process + (src < remainder ? src : remainder);
-            int src_end = src_start + items_per_process + (src < remainder ? 1 : 0);
-            
-            // Receber cada linha calculada pelo processo src
-            for (int i = src_start; i < src_end && i < num_items; i++) {
-                MPI_Recv(similarity_matrix[i], num_items, MPI_FLOAT, src, i, 
-                        MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-            }
+
+    if (options.engine == ENGINE_LSH) {
+        share_lsh_candidates(rank);
+    }
+
+    // Calcular as similaridades dos blocos deste processo
+    double compute_start = MPI_Wtime();
+
+#ifdef _OPENMP
+    #pragma omp parallel
+#endif
+    {
+        BlockWorkspace ws;
+        if (options.engine == ENGINE_BLOCKED && blocked_workspace_init(&ws, options.block_size) != 0) {
+            exit(1);
         }
-        
-        // Reconstruir simetria da matriz: [j][i] = [i][j]
-        for (int i = 0; i < num_items; i++) {
-            for (int j = i + 1; j < num_items; j++) {
-                similarity_matrix[j][i] = similarity_matrix[i][j];
+        AllPairsWorkspace index;
+        if (options.engine == ENGINE_ALLPAIRS && allpairs_workspace_init(&index, num_items) != 0) {
+            exit(1);
+        }
+
+#ifdef _OPENMP
+        #pragma omp for schedule(dynamic, 1)
+#endif
+        for (int b = 0; b < local_blocks; b++) {
+            const PairBlock *block = &blocks[b];
+            int p0 = pair_grid.group_start[block->p];
+            int p1 = pair_grid.group_start[block->p + 1];
+            int q0 = pair_grid.group_start[block->q];
+            int q1 = pair_grid.group_start[block->q + 1];
+
+            if (options.engine == ENGINE_BLOCKED) {
+                if (similarity_blocked_block(similarity_input, p0, p1, q0, q1, &ws,
+                                             store_similarity_row, (void *)block) != 0) {
+                    MPI_Abort(MPI_COMM_WORLD, 1);
+                }
+            } else if (options.engine == ENGINE_ALLPAIRS) {
+                for (int i = p0; i < p1; i++) {
+                    int count = allpairs_row(similarity_input, i, q0, q1, &index);
+                    for (int c = 0; c < count; c++) {
+                        store_similarity(block, i, index.items[c], index.sims[c]);
+                    }
+                }
+            } else if (options.engine == ENGINE_LSH) {
+                for (int i = p0; i < p1; i++) {
+                    int c = lsh_first_candidate(&lsh_candidates, i, i + 1 > q0 ? i + 1 : q0);
+                    for (; c < lsh_candidates.ptr[i + 1] && lsh_candidates.items[c] < q1; c++) {
+                        int j = lsh_candidates.items[c];
+                        store_similarity(block, i, j, cosine_similarity(i, j));
+                    }
+                }
+            } else {
+                for (int i = p0; i < p1; i++) {
+                    for (int j = (i + 1 > q0 ? i + 1 : q0); j < q1; j++) {
+                        store_similarity(block, i, j, cosine_similarity(i, j));
+                    }
+                }
             }
         }
+
+        if (options.engine == ENGINE_BLOCKED) {
+            blocked_workspace_free(&ws);
+        }
+        if (options.engine == ENGINE_ALLPAIRS) {
+#ifdef _OPENMP
+            #pragma omp atomic
+#endif
+            common_pairs += index.pairs;
+            allpairs_workspace_free(&index);
+        }
+    }
+
+    double compute_end = MPI_Wtime();
+    free(blocks);
+
+    if (options.engine == ENGINE_ALLPAIRS) {
+        MPI_Reduce(rank == 0 ? MPI_IN_PLACE : &common_pairs, &common_pairs, 1, MPI_LONG_LONG,
+                   MPI_SUM, 0, MPI_COMM_WORLD);
+    }
+    
+    if (options.top_k > 0) {
+        // Modo top-K: reduz apenas as listas de vizinhos
+        reduce_neighbor_index(rank, size);
     } else {
-        // Enviar resultados para o processo 0
-        for (int i = start_item; i < end_item && i < num_items; i++) {
-            MPI_Send(similarity_matrix[i], num_items, MPI_FLOAT, 0, i, MPI_COMM_WORLD);
+        // Coletar os blocos no processo 0
+        gather_similarity_triangle(rank, size, local_pairs);
+        
+        if (rank == 0) {
+            if (packed_triangle_convert(&similarity_triangle, options.precision) != 0) {
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+        } else {
+            free(block_values);
         }
+        block_values = NULL;
+    }
+
+    // Cálculo local x comunicação (inclui a espera pelos processos mais lentos)
+    double times[2] = { compute_end - compute_start, MPI_Wtime() - compute_end };
+    double max_times[2];
+    double sum_times[2];
+    MPI_Reduce(times, max_times, 2, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    MPI_Reduce(times, sum_times, 2, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    if (rank == 0) {
+        printf("Tempo de cálculo: %.4f s (máx), %.4f s (média por processo)\n",
+               max_times[0], sum_times[0] / size);
+        printf("Tempo de comunicação: %.4f s (máx), %.4f s (média por processo)\n",
+               max_times[1], sum_times[1] / size);
     }
 }
 
 /**
- * Compara itens por similaridade (para qsort)
+ * Gera recomendações para um usuário específico
  */
-int compare_similarity(const void *a, const void *b) {
-    ItemSimilarity *ia = (ItemSimilarity *)a;
-    ItemSimilarity *ib = (ItemSimilarity *)b;
-    
-    if (ib->similarity > ia->similarity) return 1;
-    if (ib->similarity < ia->similarity) return -1;
+void recommend_for_user(int user_id, int top_n) {
+    Scorer scorer = { &ratings, options.top_k > 0 ? &neighbors : NULL,
+                      dense_similarity, num_items };
+    RecommendScratch scratch;
+    if (recommend_scratch_init(&scratch, num_items) != 0) {
+        exit(1);
+    }
+
+    ItemSimilarity recommendations[top_n];
+    int count = recommend_user(&scorer, user_id, top_n, &scratch, recommendations);
+
+    char label[ID_MAP_LABEL_SIZE];
+    printf("\nTop %d recomendações para usuário %s:\n", top_n,
+           id_map_label(ratings.user_ids, user_id, label));
+    for (int i = 0; i < count; i++) {
+        printf("  Item %s: score %.4f\n",
+               id_map_label(ratings.item_ids, recommendations[i].item_id, label),
+               recommendations[i].similarity);
+    }
+
+    recommend_scratch_free(&scratch);
+}
+
+/**
+ * Modo build com --topk: só o processo 0 tem as listas finais de vizinhos
+ * (reduce_neighbor_index) e as linhas completas dos usuários. Ele difunde
+ * as listas, O(nK), e envia a cada processo só as linhas CSR dos usuários
+ * da faixa dele, que passam a formar o store `slice` daquele processo.
+ */
+int share_batch_inputs(const RecommendBatch *batch, const int *bounds, int rank, int size,
+                       RatingStore *slice) {
+    MPI_Bcast(neighbors.count, num_items, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Datatype entries_type = neighbor_entries_type();
+    MPI_Bcast(neighbors.entries, 1, entries_type, 0, MPI_COMM_WORLD);
+    MPI_Type_free(&entries_type);
+
+    if (rank == 0) {
+        for (int r = 1; r < size; r++) {
+            int begin = bounds[r];
+            int n = bounds[r + 1] - begin;
+            int *lengths = malloc((n > 0 ? n : 1) * sizeof(int));
+            int total = 0;
+            if (!lengths) {
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            for (int u = 0; u < n; u++) {
+                int user = batch->users[begin + u];
+                lengths[u] = user < num_users ? ratings.user_ptr[user + 1] - ratings.user_ptr[user] : 0;
+                total += lengths[u];
+            }
+
+            int *items = malloc((total > 0 ? total : 1) * sizeof(int));
+            float *values = malloc((total > 0 ? total : 1) * sizeof(float));
+            if (!items || !values) {
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            int pos = 0;
+            for (int u = 0; u < n; u++) {
+                int start = lengths[u] > 0 ? ratings.user_ptr[batch->users[begin + u]] : 0;
+                memcpy(items + pos, ratings.user_items + start, lengths[u] * sizeof(int));
+                memcpy(values + pos, ratings.user_ratings + start, lengths[u] * sizeof(float));
+                pos += lengths[u];
+            }
+
+            MPI_Send(lengths, n, MPI_INT, r, 0, MPI_COMM_WORLD);
+            MPI_Send(items, total, MPI_INT, r, 1, MPI_COMM_WORLD);
+            MPI_Send(values, total, MPI_FLOAT, r, 2, MPI_COMM_WORLD);
+            free(lengths);
+            free(items);
+            free(values);
+        }
+        return 0;
+    }
+
+    int begin = bounds[rank];
+    int n = bounds[rank + 1] - begin;
+    int *lengths = malloc((n > 0 ? n : 1) * sizeof(int));
+    if (!lengths) {
+        return -1;
+    }
+    MPI_Recv(lengths, n, MPI_INT, 0, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+
+    // Só as linhas da faixa ficam preenchidas; um usuário repetido na lista
+    // recebe a mesma linha mais de uma vez e usa a primeira
+    memset(slice, 0, sizeof(*slice));
+    slice->num_users = num_users;
+    slice->num_items = num_items;
+    slice->user_ptr = calloc(num_users + 1, sizeof(int));
+    int *row_length = calloc(num_users + 1, sizeof(int));
+    int total = 0;
+    for (int u = 0; u < n; u++) {
+        total += lengths[u];
+    }
+    int *items = malloc((total > 0 ? total : 1) * sizeof(int));
+    float *values = malloc((total > 0 ? total : 1) * sizeof(float));
+    if (!slice->user_ptr || !row_length || !items || !values) {
+        fprintf(stderr, "Erro: memória insuficiente para as linhas do lote\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    MPI_Recv(items, total, MPI_INT, 0, 1, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    MPI_Recv(values, total, MPI_FLOAT, 0, 2, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+
+    for (int u = 0; u < n; u++) {
+        int user = batch->users[begin + u];
+        if (user < num_users) row_length[user] = lengths[u];
+    }
+    for (int user = 0; user < num_users; user++) {
+        slice->user_ptr[user + 1] = slice->user_ptr[user] + row_length[user];
+    }
+    slice->num_ratings = slice->user_ptr[num_users];
+    slice->user_items = malloc((slice->num_ratings > 0 ? slice->num_ratings : 1) * sizeof(int));
+    slice->user_ratings = malloc((slice->num_ratings > 0 ? slice->num_ratings : 1) * sizeof(float));
+    if (!slice->user_items || !slice->user_ratings) {
+        fprintf(stderr, "Erro: memória insuficiente para as linhas do lote\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    int pos = 0;
+    for (int u = 0; u < n; u++) {
+        int user = batch->users[begin + u];
+        if (user < num_users && row_length[user] > 0) {
+            int dest = slice->user_ptr[user];
+            memcpy(slice->user_items + dest, items + pos, lengths[u] * sizeof(int));
+            memcpy(slice->user_ratings + dest, values + pos, lengths[u] * sizeof(float));
+            row_length[user] = 0;
+        }
+        pos += lengths[u];
+    }
+
+    free(lengths);
+    free(row_length);
+    free(items);
+    free(values);
     return 0;
 }
 
-void recommend_for_user(int user_id, int top_n) {
-    float predictions[MAX_ITEMS];
-    memset(predictions, 0, sizeof(predictions));
+/**
+ * Grava as linhas dos usuários batch->users[begin .. end - 1]. Com mais de
+ * um processo, cada um formata sua faixa em memória e a escreve no mesmo
+ * CSV via MPI-IO, no deslocamento dado pela soma prefixada dos tamanhos
+ * (MPI_Exscan): o arquivo fica idêntico ao da versão sequencial. Com
+ * --shards, cada processo grava a sua faixa em ARQ.<rank>, com cabeçalho.
+ */
+int write_batch_slice(const RecommendBatch *batch, int begin, int end, MPI_Comm comm) {
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
 
-    for (int target_item = 0; target_item < num_items; target_item++) {
-        if (ratings_matrix[user_id][target_item] > 0) {
-            continue;
+    if (options.batch_shards) {
+        char path[4096];
+        snprintf(path, sizeof(path), "%s.%d", options.batch_output, rank);
+        FILE *file = fopen(path, "w");
+        int status = file ? 0 : -1;
+        if (file) {
+            fputs(RECOMMEND_CSV_HEADER, file);
+            status = recommend_batch_print(file, batch, begin, end);
+            if (fclose(file) != 0) status = -1;
         }
+        if (status != 0) {
+            fprintf(stderr, "Erro ao gravar arquivo: %s\n", path);
+        }
+        int failed = status != 0, any_failed;
+        MPI_Allreduce(&failed, &any_failed, 1, MPI_INT, MPI_LOR, comm);
+        return any_failed ? -1 : 0;
+    }
+    if (size == 1) {
+        return recommend_batch_write(batch, options.batch_output);
+    }
+
+    char *buffer = NULL;
+    size_t length = 0;
+    FILE *memory = open_memstream(&buffer, &length);
+    if (!memory) {
+        MPI_Abort(comm, 1);
+    }
+    if (rank == 0) {
+        fputs(RECOMMEND_CSV_HEADER, memory);
+    }
+    recommend_batch_print(memory, batch, begin, end);
+    if (fclose(memory) != 0) {
+        MPI_Abort(comm, 1);
+    }
 
-        float weighted_sum = 0.0;
-        float similarity_sum = 0.0;
+    long long local = length, offset = 0;
+    MPI_Exscan(&local, &offset, 1, MPI_LONG_LONG, MPI_SUM, comm);
+    if (rank == 0) offset = 0;  // MPI_Exscan não define o resultado do processo 0
 
-        for (int rated_item = 0; rated_item < num_items; rated_item++) {
-            float user_rating = ratings_matrix[user_id][rated_item];
-            
-            if (user_rating > 0) {
-                float sim = similarity_matrix[target_item][rated_item];
-                weighted_sum += sim * user_rating;
-                similarity_sum += fabs(sim);
+    MPI_File fh;
+    if (MPI_File_open(comm, options.batch_output, MPI_MODE_CREATE | MPI_MODE_WRONLY,
+                      MPI_INFO_NULL, &fh) != MPI_SUCCESS) {
+        if (rank == 0) fprintf(stderr, "Erro ao criar arquivo: %s\n", options.batch_output);
+        free(buffer);
+        return -1;
+    }
+    MPI_File_set_size(fh, 0);
+
+    // Escrita coletiva em pedaços de até 1 GB (contagem int do MPI)
+    const long long chunk = 1LL << 30;
+    long long pieces = (local + chunk - 1) / chunk, max_pieces;
+    MPI_Allreduce(&pieces, &max_pieces, 1, MPI_LONG_LONG, MPI_MAX, comm);
+    int status = MPI_SUCCESS;
+    for (long long p = 0; p < max_pieces; p++) {
+        long long done = p * chunk < local ? p * chunk : local;
+        int count = (int)(local - done < chunk ? local - done : chunk);
+        int rc = MPI_File_write_at_all(fh, offset + done, buffer + done, count, MPI_CHAR,
+                                       MPI_STATUS_IGNORE);
+        if (rc != MPI_SUCCESS) status = rc;
+    }
+    MPI_File_close(&fh);
+    free(buffer);
+
+    int failed = status != MPI_SUCCESS, any_failed;
+    MPI_Allreduce(&failed, &any_failed, 1, MPI_INT, MPI_LOR, comm);
+    if (any_failed && rank == 0) {
+        fprintf(stderr, "Erro ao gravar arquivo: %s\n", options.batch_output);
+    }
+    return any_failed ? -1 : 0;
+}
+
+/**
+ * Lote de recomendações (--users) distribuído entre os processos de `comm`:
+ * a lista é dividida em faixas contíguas de custo parecido, cada processo
+ * pontua a sua (com threads OpenMP no binário híbrido) e grava o resultado
+ * em paralelo (write_batch_slice). `replicated` indica que todos já têm as
+ * avaliações e a similaridade completas (modo serve); senão, no modo build
+ * com --topk, o processo 0 envia o que falta (share_batch_inputs).
+ */
+int recommend_batch_to_file(MPI_Comm comm, int replicated) {
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+
+    RecommendBatch batch;
+    if (recommend_batch_init(&batch, options.batch_users, &ratings, options.top_n) != 0) {
+        return -1;
+    }
+
+    int *bounds = malloc((size + 1) * sizeof(int));
+    if (!bounds) {
+        MPI_Abort(comm, 1);
+    }
+    if (rank == 0) {
+        recommend_batch_split(&batch, &ratings, size, bounds);
+    }
+    MPI_Bcast(bounds, size + 1, MPI_INT, 0, comm);
+    int begin = bounds[rank];
+    int end = bounds[rank + 1];
+
+    RatingStore slice;
+    const RatingStore *rs = &ratings;
+    if (!replicated && size > 1) {
+        if (share_batch_inputs(&batch, bounds, rank, size, &slice) != 0) {
+            MPI_Abort(comm, 1);
+        }
+        if (rank != 0) rs = &slice;
+    }
+    Scorer scorer = { rs, options.top_k > 0 ? &neighbors : NULL,
+                      dense_similarity, num_items };
+
+    double start = MPI_Wtime();
+
+#ifdef _OPENMP
+    #pragma omp parallel
+#endif
+    {
+        RecommendScratch scratch;
+        if (recommend_scratch_init(&scratch, num_items) != 0) {
+            exit(1);
+        }
+
+#ifdef _OPENMP
+        #pragma omp for schedule(dynamic, 16)
+#endif
+        for (int u = begin; u < end; u++) {
+            recommend_batch_range(&scorer, &batch, u, u + 1, &scratch);
+        }
+
+        recommend_scratch_free(&scratch);
+    }
+
+    double local_elapsed = MPI_Wtime() - start, elapsed;
+    MPI_Reduce(&local_elapsed, &elapsed, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+
+    int status = write_batch_slice(&batch, begin, end, comm);
+    if (status == 0 && rank == 0) {
+        printf("\n=== Lote de Recomendações ===\n");
+        printf("Usuários: %d (top-%d cada)\n", batch.num_users, batch.top_n);
+        if (size > 1) {
+            printf("Processos no lote: %d\n", size);
+        }
+        printf("Tempo do lote: %.4f segundos (%.0f usuários/s)\n", elapsed,
+               elapsed > 0 ? batch.num_users / elapsed : 0.0);
+        if (options.batch_shards) {
+            printf("Resultados gravados em %s.0 .. %s.%d\n", options.batch_output,
+                   options.batch_output, size - 1);
+        } else {
+            printf("Resultados gravados em %s\n", options.batch_output);
+        }
+    }
+
+    if (rs == &slice) {
+        rating_store_free(&slice);
+    }
+    free(bounds);
+    recommend_batch_free(&batch);
+    return status;
+}
+
+/**
+ * Modo build: grava o modelo calculado para ser servido com --serve
+ */
+int save_model(const char *path, const char *source, double build_seconds) {
+    ModelBuildInfo info = { options_engine_name(options.engine), source, build_seconds,
+                            options.metric };
+
+    if (model_save(path, &ratings, options.top_k > 0 ? &neighbors : NULL,
+                   &similarity_triangle, &info) != 0) {
+        return -1;
+    }
+    printf("Modelo salvo em %s\n", path);
+    return 0;
+}
+
+/**
+ * --accuracy: compara a similaridade calculada com a referência float64
+ */
+void report_accuracy() {
+    AccuracyReport report;
+    if (accuracy_report(similarity_input, options.top_k > 0 ? NULL : &similarity_triangle,
+                        options.top_k > 0 ? &neighbors : NULL, &report) == 0) {
+        accuracy_print(&report, stdout);
+    }
+}
+
+/**
+ * Modo serve: mapeia um modelo salvo e gera recomendações sem ler as
+ * avaliações nem recalcular a similaridade. Todos os processos mapeiam o
+ * mesmo arquivo (no mesmo nó as páginas são compartilhadas) e dividem o
+ * lote de usuários entre si.
+ */
+int serve_model(const char *path, int rank) {
+    Model model;
+    double start = MPI_Wtime();
+
+    // Todos os processos participam do lote: uma falha local encerra todos
+    if (model_open(&model, path) != 0) {
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    // As estruturas globais passam a apontar para as páginas mapeadas
+    ratings = model.ratings;
+    num_users = ratings.num_users;
+    num_items = ratings.num_items;
+    num_ratings = ratings.num_ratings;
+    if (model.header->kind == MODEL_NEIGHBORS) {
+        neighbors = model.neighbors;
+        options.top_k = neighbors.k;
+    } else {
+        dense_similarity = &model.triangle;
+    }
+
+    double elapsed = MPI_Wtime() - start;
+
+    if (rank == 0) {
+        model_print_info(&model, stdout);
+        printf("Modelo mapeado em %.4f ms\n", elapsed * 1000.0);
+
+        printf("\n=== Exemplos de Recomendações ===\n");
+        recommend_for_user(0, TOP_K);
+        recommend_for_user(1, TOP_K);
+        fflush(stdout);
+    }
+
+    int status = options.batch_users ? recommend_batch_to_file(MPI_COMM_WORLD, 1) : 0;
+    model_close(&model);
+    return status == 0 ? 0 : 1;
+}
+
+/**
+ * Grava a linha completa recalculada de um item afetado pelo delta
+ */
+void store_updated_row(int item, const float *row) {
+    if (options.top_k > 0) {
+        neighbor_index_reset_row(&neighbors, item);
+        for (int j = 0; j < num_items; j++) {
+            neighbor_index_offer(&neighbors, item, j, row[j]);
+        }
+    } else {
+        for (int j = 0; j < num_items; j++) {
+            // O par com outro item alterado é escrito só pelo de menor índice
+            if (j != item && (!update_is_row[j] || item < j)) {
+                size_t k = item < j ? triangle_index(num_items, item, j)
+                                    : triangle_index(num_items, j, item);
+                similarity_triangle.values[k] = row[j];
             }
         }
+    }
+}
+
+/**
+ * Atualização incremental: aplica um delta de avaliações a um modelo salvo
+ * e recalcula apenas as linhas dos itens afetados. Como o modo serve, roda
+ * só no processo 0: o delta costuma tocar uma fração pequena dos itens.
+ */
+int update_model(const char *path) {
+    Model model;
+    Rating *delta;
+    int count;
+    long long bytes;
+
+    if (model_open(&model, path) != 0) {
+        return 1;
+    }
+    if (rating_delta_check_ids(&model.ratings, options.remap_ids) != 0) {
+        model_close(&model);
+        return 1;
+    }
+    int load_threads = options.load_threads > 0 ? options.load_threads : 1;
+    if (parse_ratings_file(options.update_path, 0, load_threads, &delta, &count, &bytes) != 0) {
+        model_close(&model);
+        return 1;
+    }
+    int status = rating_store_apply_delta(&ratings, &model.ratings, delta, count, &changes);
+    free(delta);
+    if (status != 0) {
+        model_close(&model);
+        return 1;
+    }
 
-        if (similarity_sum > 0) {
-            predictions[target_item] = weighted_sum / similarity_sum;
+    num_users = ratings.num_users;
+    num_items = ratings.num_items;
+    num_ratings = ratings.num_ratings;
+    if (model.header->kind == MODEL_NEIGHBORS) {
+        if (model_copy_neighbors(&model, &neighbors, num_items) != 0) {
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        options.top_k = neighbors.k;
+    } else {
+        if (model_copy_triangle(&model, &similarity_triangle, num_items) != 0) {
+            MPI_Abort(MPI_COMM_WORLD, 1);
         }
     }
+    model_print_info(&model, stdout);
 
-    ItemSimilarity recommendations[MAX_ITEMS];
-    int count = 0;
-    
-    for (int i = 0; i < num_items; i++) {
-        if (predictions[i] > 0) {
-            recommendations[count].item_id = i;
-            recommendations[count].similarity = predictions[i];
-            count++;
+    // A similaridade atualizada usa a métrica do modelo, com médias refeitas
+    options.metric = (SimilarityMetric)model.header->metric;
+    if (prepare_metric(options.metric, MPI_COMM_SELF) != 0) {
+        exit(1);
+    }
+
+    // Matriz densa: só as linhas alteradas; top-K: todas as listas tocadas
+    const int *rows;
+    int num_rows = rating_delta_rows(&changes, &ratings, options.metric, options.top_k, &rows,
+                                     &update_is_row);
+
+    double start = MPI_Wtime();
+
+    RowWorkspace ws;
+    if (row_workspace_init(&ws, num_items) != 0) {
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    for (int r = 0; r < num_rows; r++) {
+        similarity_item_row(similarity_input, rows[r], &ws);
+        store_updated_row(rows[r], ws.row);
+    }
+    row_workspace_free(&ws);
+
+    if (options.top_k > 0) {
+        neighbor_index_finalize(&neighbors);
+    } else if (packed_triangle_convert(&similarity_triangle, model.triangle.precision) != 0) {
+        MPI_Abort(MPI_COMM_WORLD, 1);  // o modelo atualizado mantém a precisão do original
+    }
+
+    double elapsed = MPI_Wtime() - start;
+
+    printf("\n=== Atualização Incremental ===\n");
+    printf("Delta: %d avaliações alteradas de %d usuários (%s)\n",
+           changes.num_updates, changes.num_users, options.update_path);
+    printf("Linhas recalculadas: %d de %d itens (%.1f%%)\n", num_rows, num_items,
+           num_items > 0 ? 100.0 * num_rows / num_items : 0.0);
+    printf("Tempo de execução: %.4f segundos\n", elapsed);
+
+    if (options.save_model_path) {
+        ModelBuildInfo info = { "incremental", model.header->source, elapsed, options.metric };
+        if (model_save(options.save_model_path, &ratings, options.top_k > 0 ? &neighbors : NULL,
+                       &similarity_triangle, &info) != 0) {
+            model_close(&model);
+            return 1;
         }
+        printf("Modelo salvo em %s\n", options.save_model_path);
     }
+    model_close(&model);
 
-    qsort(recommendations, count, sizeof(ItemSimilarity), compare_similarity);
+    printf("\n=== Exemplos de Recomendações ===\n");
+    recommend_for_user(0, TOP_K);
+    recommend_for_user(1, TOP_K);
 
-    printf("\nTop %d recomendações para usuário %d:\n", top_n, user_id);
-    for (int i = 0; i < top_n && i < count; i++) {
-        printf("  Item %d: score %.4f\n", 
-               recommendations[i].item_id, 
-               recommendations[i].similarity);
+    rating_delta_free(&changes);
+    if (options.batch_users && recommend_batch_to_file(MPI_COMM_SELF, 1) != 0) {
+        return 1;
     }
+    return 0;
 }
 
 int main(int argc, char *argv[]) {
     int rank, size;
     double start_time, end_time;
 
+#ifdef _OPENMP
+    // Só a thread principal chama MPI; as regiões paralelas não comunicam
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+    if (provided < MPI_THREAD_FUNNELED) {
+        fprintf(stderr, "Aviso: MPI sem suporte a MPI_THREAD_FUNNELED; usando 1 thread\n");
+        omp_set_num_threads(1);
+    }
+#else
     MPI_Init(&argc, &argv);
+#endif
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &size);
 
-    if (argc < 2) {
+    options_init(&options);
+    if (argc < 2 || options_parse(&options, argc, argv, 2) != 0) {
+        if (rank == 0) {
+            fprintf(stderr, "Uso: mpirun -np <num_processos> %s <arquivo_avaliacoes> [opções]\n", argv[0]);
+            options_print_usage(stderr);
+        }
+        MPI_Finalize();
+        return 1;
+    }
+
+    if (simd_init(options.simd) != 0) {
+        if (rank == 0) {
+            fprintf(stderr, "CPU sem suporte aos kernels %s\n", simd_level_name(options.simd));
+        }
+        MPI_Finalize();
+        return 1;
+    }
+
+    // O build fora da memória é de um nó só: os blocos dependem das listas em disco
+    if (options.memory_budget > 0) {
+        if (rank == 0) {
+            fprintf(stderr, "--memory-budget só nas versões sequencial, OpenMP e Pthreads\n");
+        }
+        MPI_Finalize();
+        return 1;
+    }
+
+    // A carga distribuída usa os IDs como índice; modelos remapeados são servidos normalmente
+    if (options.remap_ids && !options.serve) {
         if (rank == 0) {
-            fprintf(stderr, "Uso: mpirun -np <num_processos> %s <arquivo_avaliacoes>\n", argv[0]);
+            fprintf(stderr, "--remap-ids só nas versões sequencial, OpenMP e Pthreads\n");
         }
         MPI_Finalize();
         return 1;
@@ -232,21 +1438,27 @@ int main(int argc, char *argv[]) {
         printf("Processos: %d\n\n", size);
     }
 
-    // Processo 0 carrega os dados
-    if (rank == 0) {
-        if (load_ratings(argv[1]) != 0) {
-            MPI_Abort(MPI_COMM_WORLD, 1);
-            return 1;
-        }
+    // Atualização incremental: o processo 0 aplica o delta ao modelo
+    if (options.update_path) {
+        int status = rank == 0 ? update_model(argv[1]) : 0;
+        MPI_Finalize();
+        return status;
     }
 
-    // Broadcast dos metadados para todos os processos
-    MPI_Bcast(&num_users, 1, MPI_INT, 0, MPI_COMM_WORLD);
-    MPI_Bcast(&num_items, 1, MPI_INT, 0, MPI_COMM_WORLD);
-    MPI_Bcast(&num_ratings, 1, MPI_INT, 0, MPI_COMM_WORLD);
-    
-    // Broadcast da matriz de avaliações
-    MPI_Bcast(ratings_matrix, MAX_USERS * MAX_ITEMS, MPI_FLOAT, 0, MPI_COMM_WORLD);
+    // Modo serve: todos os processos mapeiam o modelo e dividem o lote
+    if (options.serve) {
+        int status = serve_model(argv[1], rank);
+        MPI_Finalize();
+        return status;
+    }
+
+    // Cada processo lê sua faixa do arquivo e recebe só as colunas de que
+    // precisa; as médias da métrica vêm do processo 0
+    if (load_ratings(argv[1], rank, size) != 0 ||
+        prepare_metric(options.metric, MPI_COMM_WORLD) != 0) {
+        MPI_Abort(MPI_COMM_WORLD, 1);
+        return 1;
+    }
 
     // Medir tempo de execução
     MPI_Barrier(MPI_COMM_WORLD);
@@ -265,11 +1477,54 @@ int main(int argc, char *argv[]) {
         printf("\n=== Resultados ===\n");
         printf("Tempo de execução: %.4f segundos\n", elapsed);
         printf("Número de processos: %d\n", size);
-        printf("Número de comparações: %d\n", (num_items * (num_items - 1)) / 2);
+        printf("Threads por processo: %d\n", rank_threads());
+        printf("Motor de similaridade: %s\n", options_engine_name(options.engine));
+        printf("Métrica: %s\n", metric_name(options.metric));
+        printf("Kernel SIMD: %s\n", simd_level_name(simd_level()));
+        printf("Acumuladores: %s\n", ACCUM_NAME);
+        if (options.top_k > 0) {
+            printf("Índice de vizinhos: top-%d por item\n", options.top_k);
+        } else {
+            printf("Matriz de similaridade: triângulo em %s (%.1f MB)\n",
+                   triangle_precision_name(similarity_triangle.precision),
+                   packed_triangle_bytes(num_items, similarity_triangle.precision) / 1e6);
+        }
+        if (options.engine == ENGINE_LSH) {
+            printf("Número de comparações: %lld candidatos LSH de %lld pares\n",
+                   lsh_candidates.num_pairs, (long long)num_items * (num_items - 1) / 2);
+        } else if (options.engine == ENGINE_ALLPAIRS) {
+            printf("Número de comparações: %lld pares com avaliador comum de %lld\n",
+                   common_pairs, (long long)num_items * (num_items - 1) / 2);
+        } else {
+            printf("Número de comparações: %lld\n", (long long)num_items * (num_items - 1) / 2);
+        }
+
+        if (options.save_model_path && save_model(options.save_model_path, argv[1], elapsed) != 0) {
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+
+        if (options.accuracy) {
+            report_accuracy();
+        }
 
         printf("\n=== Exemplos de Recomendações ===\n");
         recommend_for_user(0, TOP_K);
         recommend_for_user(1, TOP_K);
+        fflush(stdout);
+    }
+
+    // Lote: com --topk os processos dividem os usuários; a matriz densa
+    // só existe completa no processo 0, que pontua o lote sozinho
+    if (options.batch_users) {
+        int status = 0;
+        if (options.top_k > 0) {
+            status = recommend_batch_to_file(MPI_COMM_WORLD, 0);
+        } else if (rank == 0) {
+            status = recommend_batch_to_file(MPI_COMM_SELF, 1);
+        }
+        if (status != 0) {
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
     }
 
     MPI_Finalize();
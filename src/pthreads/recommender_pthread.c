@@ -12,37 +12,73 @@
 #include <pthread.h>
 #include <sys/time.h>
 
-#define MAX_USERS 10000
-#define MAX_ITEMS 10000
+#include "ratings.h"
+#include "parser.h"
+#include "similarity.h"
+#include "blocked.h"
+#include "neighbors.h"
+#include "model.h"
+#include "partition.h"
+#include "triangle.h"
+#include "incremental.h"
+#include "recommend.h"
+#include "accuracy.h"
+#include "lsh.h"
+#include "allpairs.h"
+#include "outofcore.h"
+#include "options.h"
+
 #define MAX_RATINGS 1000000
 #define TOP_K 10
-
-typedef struct {
-    int user_id;
-    int item_id;
-    float rating;
-} Rating;
-
-typedef struct {
-    int item_id;
-    float similarity;
-} ItemSimilarity;
+#define TILES_PER_THREAD 8  // ladrilhos de área igual por thread na fila de trabalho
+#define PAIR_TILE 64        // lado dos ladrilhos quadrados do triângulo no motor por pares
 
 typedef struct {
     int thread_id;
-    int start_item;
-    int end_item;
+
+    // Estatísticas do escalonamento por ladrilhos
+    int tiles;
+    long long pairs;
+    double busy;      // tempo dentro dos ladrilhos
+    double finished;  // instante em que a thread ficou sem trabalho
 } ThreadData;
 
-float ratings_matrix[MAX_USERS][MAX_ITEMS];
+// Avaliações em formato esparso (visões CSR e CSC)
+RatingStore ratings;
 int num_users = 0;
 int num_items = 0;
 int num_ratings = 0;
-float similarity_matrix[MAX_ITEMS][MAX_ITEMS];
+// Avaliações vistas pela similaridade: as próprias ou centradas (--metric)
+MetricInput metric_input;
+const RatingStore *similarity_input = &ratings;
+
+// Matriz de similaridade entre itens (triângulo superior empacotado)
+PackedTriangle similarity_triangle;
+
+// Pares candidatos do motor aproximado (--engine=lsh)
+LshCandidates lsh_candidates;
+
+// Motor allpairs: pares com avaliador comum efetivamente calculados
+long long common_pairs = 0;
+
+// Triângulo usado no scoring: o calculado acima ou o de um modelo mapeado
+const PackedTriangle *dense_similarity = &similarity_triangle;
+NeighborIndex neighbors;
 
 int num_threads_global = 1;
+Options options;
 pthread_mutex_t progress_mutex = PTHREAD_MUTEX_INITIALIZER;
 
+// Fila de ladrilhos do triângulo: faixa t = [tile_bounds[t], tile_bounds[t + 1])
+int *tile_bounds;
+int num_tiles;
+int next_tile;
+
+// Atualização incremental (--update): itens afetados e linhas a recalcular
+RatingDelta changes;
+const int *update_rows;
+const unsigned char *update_is_row;
+
 double get_time() {
     struct timeval tv;
     gettimeofday(&tv, NULL);
@@ -52,121 +88,249 @@ double get_time() {
 /**
  * Carrega as avaliações de um arquivo
  */
-int load_ratings(const char *filename) {
-    FILE *file = fopen(filename, "r");
-    if (!file) {
-        fprintf(stderr, "Erro ao abrir arquivo: %s\n", filename);
+int load_ratings(const char *filename, int num_threads) {
+    LoadStats stats;
+    int load_threads = options.load_threads > 0 ? options.load_threads : num_threads;
+
+    int status = options.remap_ids
+                     ? rating_store_load_keys(&ratings, filename, 0, load_threads, &stats)
+                     : rating_store_load(&ratings, filename, 0, load_threads, &stats);
+    if (status != 0) {
         return -1;
     }
 
-    memset(ratings_matrix, 0, sizeof(ratings_matrix));
-
-    int user, item;
-    float rating;
-    num_users = 0;
-    num_items = 0;
-    num_ratings = 0;
-
-    while (fscanf(file, "%d %d %f", &user, &item, &rating) == 3) {
-        if (user >= MAX_USERS || item >= MAX_ITEMS) {
-            continue;
-        }
-        
-        ratings_matrix[user][item] = rating;
-        if (user >= num_users) num_users = user + 1;
-        if (item >= num_items) num_items = item + 1;
-        num_ratings++;
-    }
+    num_users = ratings.num_users;
+    num_items = ratings.num_items;
+    num_ratings = ratings.num_ratings;
 
-    fclose(file);
     printf("Carregados: %d usuários, %d itens, %d avaliações\n", 
            num_users, num_items, num_ratings);
+    printf("Tempo de carga: %.4f segundos (leitura %.4f s com %d thread(s), construção CSR/CSC %.4f s)\n",
+           stats.parse_seconds + stats.build_seconds, stats.parse_seconds, stats.threads,
+           stats.build_seconds);
     return 0;
 }
 
 /**
- * Calcula a similaridade de cosseno entre dois itens
+ * Médias e avaliações centradas da métrica, calculadas uma vez antes da
+ * similaridade; as predições continuam usando as notas originais
+ */
+int prepare_metric(SimilarityMetric metric) {
+    if (metric_input_init(&metric_input, &ratings, metric, NULL, NULL) != 0) {
+        return -1;
+    }
+    similarity_input = &metric_input.view;
+    return 0;
+}
+
+/**
+ * Calcula a similaridade de cosseno entre dois itens (sobre as avaliações
+ * centradas com --metric=adjusted|pearson)
  */
 float cosine_similarity(int item1, int item2) {
-    float dot_product = 0.0;
-    float norm1 = 0.0;
-    float norm2 = 0.0;
+    // Interseção das listas de usuários dos dois itens (merge/galope)
+    return similarity_cosine(similarity_input, item1, item2);
+}
 
-    for (int user = 0; user < num_users; user++) {
-        float r1 = ratings_matrix[user][item1];
-        float r2 = ratings_matrix[user][item2];
-        
-        if (r1 > 0 && r2 > 0) {
-            dot_product += r1 * r2;
-            norm1 += r1 * r1;
-            norm2 += r2 * r2;
-        }
+/**
+ * Grava a similaridade do par (i, j), i < j, no triângulo empacotado ou no
+ * índice top-K. Sem escrita espelhada: a linha i do triângulo só é escrita
+ * pela thread dona do ladrilho que contém a linha.
+ */
+void store_similarity(int i, int j, float sim) {
+    if (options.top_k > 0) {
+        neighbor_index_offer(&neighbors, i, j, sim);
+        neighbor_index_offer(&neighbors, j, i, sim);
+    } else {
+        similarity_triangle.values[triangle_index(num_items, i, j)] = sim;
     }
+}
 
-    if (norm1 == 0.0 || norm2 == 0.0) {
-        return 0.0;
+/**
+ * Grava um segmento de linha calculado pelo motor em blocos
+ */
+void store_similarity_row(int item, int first, const float *sims, int count, void *ctx) {
+    for (int k = 0; k < count; k++) {
+        store_similarity(item, first + k, sims[k]);
     }
-
-    return dot_product / (sqrt(norm1) * sqrt(norm2));
 }
 
 /**
- * Função executada por cada thread
- * Calcula similaridade para um subconjunto de itens
+ * Calcula os pares (i, j), j > i, das linhas [start, end)
  */
-void *compute_similarity_worker(void *arg) {
-    ThreadData *data = (ThreadData *)arg;
-    int thread_id = data->thread_id;
-    int start = data->start_item;
-    int end = data->end_item;
-
-    for (int i = start; i < end && i < num_items; i++) {
-        for (int j = i; j < num_items; j++) {
-            if (i == j) {
-                similarity_matrix[i][j] = 1.0;
-            } else {
-                float sim = cosine_similarity(i, j);
-                similarity_matrix[i][j] = sim;
-                similarity_matrix[j][i] = sim;
+void compute_similarity_rows(int thread_id, int start, int end, BlockWorkspace *ws,
+                             AllPairsWorkspace *index) {
+    if (options.engine == ENGINE_BLOCKED) {
+        if (similarity_blocked_rows(similarity_input, start, end, ws,
+                                    store_similarity_row, NULL) != 0) {
+            exit(1);
+        }
+        return;
+    }
+    if (options.engine == ENGINE_ALLPAIRS) {
+        for (int i = start; i < end; i++) {
+            int count = allpairs_row(similarity_input, i, 0, num_items, index);
+            for (int c = 0; c < count; c++) {
+                store_similarity(i, index->items[c], index->sims[c]);
+            }
+        }
+        return;
+    }
+    if (options.engine == ENGINE_LSH) {
+        for (int i = start; i < end; i++) {
+            for (int p = lsh_candidates.ptr[i]; p < lsh_candidates.ptr[i + 1]; p++) {
+                int j = lsh_candidates.items[p];
+                store_similarity(i, j, cosine_similarity(i, j));
+            }
+        }
+        return;
+    }
+
+    if (end > num_items) end = num_items;
+    for (int i0 = start; i0 < end; i0 += PAIR_TILE) {
+        int i1 = i0 + PAIR_TILE < end ? i0 + PAIR_TILE : end;
+
+        // Ladrilhos (I, J) com J >= I: as colunas de J são reaproveitadas por todo I
+        for (int j0 = i0; j0 < num_items; j0 += PAIR_TILE) {
+            int j1 = j0 + PAIR_TILE < num_items ? j0 + PAIR_TILE : num_items;
+            for (int i = i0; i < i1; i++) {
+                for (int j = (i + 1 > j0 ? i + 1 : j0); j < j1; j++) {
+                    store_similarity(i, j, cosine_similarity(i, j));
+                }
             }
         }
         
         // Progresso (com mutex para evitar race condition)
-        if ((i + 1) % 100 == 0) {
+        if (i1 / 100 > i0 / 100) {
             pthread_mutex_lock(&progress_mutex);
-            printf("Thread %d: Processado %d/%d itens\n", thread_id, i + 1, end);
+            printf("Thread %d: Processado %d/%d itens\n", thread_id, i1, num_items);
             pthread_mutex_unlock(&progress_mutex);
         }
     }
+}
 
+/**
+ * Função executada por cada thread: retira ladrilhos de área igual da
+ * fila (contador atômico) até esvaziá-la
+ */
+void *compute_similarity_worker(void *arg) {
+    ThreadData *data = (ThreadData *)arg;
+
+    // Motor em blocos: ladrilho e cursores privados da thread
+    BlockWorkspace ws;
+    if (options.engine == ENGINE_BLOCKED && blocked_workspace_init(&ws, options.block_size) != 0) {
+        exit(1);
+    }
+
+    // Motor allpairs: acumuladores do índice invertido privados da thread
+    AllPairsWorkspace index;
+    memset(&index, 0, sizeof(index));
+    if (options.engine == ENGINE_ALLPAIRS && allpairs_workspace_init(&index, num_items) != 0) {
+        exit(1);
+    }
+
+    int tile;
+    while ((tile = __atomic_fetch_add(&next_tile, 1, __ATOMIC_RELAXED)) < num_tiles) {
+        int start = tile_bounds[tile];
+        int end = tile_bounds[tile + 1];
+        double tile_start = get_time();
+        long long computed = index.pairs;
+
+        compute_similarity_rows(data->thread_id, start, end, &ws, &index);
+
+        data->busy += get_time() - tile_start;
+        data->tiles++;
+        if (options.engine == ENGINE_LSH) {
+            data->pairs += lsh_candidates.ptr[end] - lsh_candidates.ptr[start];
+        } else if (options.engine == ENGINE_ALLPAIRS) {
+            data->pairs += index.pairs - computed;
+        } else {
+            data->pairs += triangle_pairs(start, end, num_items);
+        }
+    }
+    data->finished = get_time();
+
+    if (options.engine == ENGINE_BLOCKED) {
+        blocked_workspace_free(&ws);
+    }
+    if (options.engine == ENGINE_ALLPAIRS) {
+        __atomic_fetch_add(&common_pairs, index.pairs, __ATOMIC_RELAXED);
+        allpairs_workspace_free(&index);
+    }
     pthread_exit(NULL);
 }
 
+/**
+ * Tempo ocupado/ocioso de cada thread: ociosa = fim da última thread - ocupada
+ */
+void print_thread_balance(const ThreadData *thread_data, int num_threads, double start) {
+    double end = start;
+    double busy_sum = 0.0;
+    double busy_max = 0.0;
+    for (int i = 0; i < num_threads; i++) {
+        if (thread_data[i].finished > end) end = thread_data[i].finished;
+        busy_sum += thread_data[i].busy;
+        if (thread_data[i].busy > busy_max) busy_max = thread_data[i].busy;
+    }
+
+    printf("Balanceamento (%d ladrilhos de área igual):\n", num_tiles);
+    for (int i = 0; i < num_threads; i++) {
+        printf("  Thread %d: %d ladrilhos, %lld pares, ocupada %.4f s, ociosa %.4f s\n",
+               i, thread_data[i].tiles, thread_data[i].pairs, thread_data[i].busy,
+               end - start - thread_data[i].busy);
+    }
+    if (busy_sum > 0) {
+        printf("  Desbalanceamento (máx/média ocupada): %.3f\n",
+               busy_max / (busy_sum / num_threads));
+    }
+}
+
 /**
  * Calcula a matriz de similaridade usando Pthreads
  */
 void compute_similarity_matrix(int num_threads) {
-    printf("Calculando matriz de similaridade com %d threads (Pthreads)...\n", num_threads);
+    printf("Calculando matriz de similaridade com %d threads (Pthreads, motor %s)...\n",
+           num_threads, options_engine_name(options.engine));
+
+    if (options.top_k > 0) {
+        if (neighbor_index_init(&neighbors, num_items, options.top_k, options.min_similarity) != 0) {
+            exit(1);
+        }
+    } else if (packed_triangle_init(&similarity_triangle, num_items) != 0) {
+        exit(1);
+    }
+
+    // Motor aproximado: os candidatos do LSH são gerados antes das threads
+    if (options.engine == ENGINE_LSH) {
+        double lsh_start = get_time();
+        if (lsh_candidates_build(similarity_input, &options.lsh, &lsh_candidates) != 0) {
+            exit(1);
+        }
+        lsh_print_summary(&lsh_candidates, &options.lsh, get_time() - lsh_start, stdout);
+    }
     
+    // Ladrilhos contíguos de área (número de pares) igual, não de linhas iguais
+    tile_bounds = malloc((num_threads * TILES_PER_THREAD + 1) * sizeof(int));
+    if (!tile_bounds) {
+        fprintf(stderr, "Erro: memória insuficiente para os ladrilhos\n");
+        exit(1);
+    }
+    num_tiles = triangle_partition(num_items, num_threads * TILES_PER_THREAD, 1, tile_bounds);
+    next_tile = 0;
+
     pthread_t threads[num_threads];
     ThreadData thread_data[num_threads];
-    
-    int items_per_thread = num_items / num_threads;
-    int remainder = num_items % num_threads;
+    memset(thread_data, 0, sizeof(thread_data));
+    double start = get_time();
     
     // Criar threads
-    int start_item = 0;
     for (int i = 0; i < num_threads; i++) {
         thread_data[i].thread_id = i;
-        thread_data[i].start_item = start_item;
-        thread_data[i].end_item = start_item + items_per_thread + (i < remainder ? 1 : 0);
         
         if (pthread_create(&threads[i], NULL, compute_similarity_worker, &thread_data[i]) != 0) {
             fprintf(stderr, "Erro ao criar thread %d\n", i);
             exit(1);
         }
-        
-        start_item = thread_data[i].end_item;
     }
     
     // Aguardar conclusão de todas as threads
@@ -176,70 +340,432 @@ void compute_similarity_matrix(int num_threads) {
             exit(1);
         }
     }
+
+    print_thread_balance(thread_data, num_threads, start);
+    free(tile_bounds);
+
+    if (options.top_k > 0) {
+        neighbor_index_finalize(&neighbors);
+    } else if (packed_triangle_convert(&similarity_triangle, options.precision) != 0) {
+        exit(1);
+    }
 }
 
 
-int compare_similarity(const void *a, const void *b) {
-    ItemSimilarity *ia = (ItemSimilarity *)a;
-    ItemSimilarity *ib = (ItemSimilarity *)b;
-    
-    if (ib->similarity > ia->similarity) return 1;
-    if (ib->similarity < ia->similarity) return -1;
+/**
+ * Gera recomendações para um usuário específico
+ */
+void recommend_for_user(int user_id, int top_n) {
+    Scorer scorer = { &ratings, options.top_k > 0 ? &neighbors : NULL,
+                      dense_similarity, num_items };
+    RecommendScratch scratch;
+    if (recommend_scratch_init(&scratch, num_items) != 0) {
+        exit(1);
+    }
+
+    ItemSimilarity recommendations[top_n];
+    int count = recommend_user(&scorer, user_id, top_n, &scratch, recommendations);
+
+    char label[ID_MAP_LABEL_SIZE];
+    printf("\nTop %d recomendações para usuário %s:\n", top_n,
+           id_map_label(ratings.user_ids, user_id, label));
+    for (int i = 0; i < count; i++) {
+        printf("  Item %s: score %.4f\n",
+               id_map_label(ratings.item_ids, recommendations[i].item_id, label),
+               recommendations[i].similarity);
+    }
+
+    recommend_scratch_free(&scratch);
+}
+
+typedef struct {
+    const Scorer *scorer;
+    RecommendBatch *batch;
+    int begin;
+    int end;
+} BatchThreadData;
+
+/**
+ * Pontua os usuários batch->users[begin .. end - 1]
+ */
+void *recommend_batch_worker(void *arg) {
+    BatchThreadData *data = (BatchThreadData *)arg;
+
+    RecommendScratch scratch;
+    if (recommend_scratch_init(&scratch, num_items) != 0) {
+        exit(1);
+    }
+    recommend_batch_range(data->scorer, data->batch, data->begin, data->end, &scratch);
+    recommend_scratch_free(&scratch);
+
+    pthread_exit(NULL);
+}
+
+/**
+ * Lote de recomendações (--users): cada thread pontua uma faixa contígua
+ * da lista com seus próprios buffers; o CSV vai para options.batch_output
+ */
+int recommend_batch_to_file(int num_threads) {
+    RecommendBatch batch;
+    if (recommend_batch_init(&batch, options.batch_users, &ratings, options.top_n) != 0) {
+        return -1;
+    }
+    Scorer scorer = { &ratings, options.top_k > 0 ? &neighbors : NULL,
+                      dense_similarity, num_items };
+
+    double start = get_time();
+
+    pthread_t threads[num_threads];
+    BatchThreadData thread_data[num_threads];
+    int users_per_thread = batch.num_users / num_threads;
+    int remainder = batch.num_users % num_threads;
+
+    int start_user = 0;
+    for (int i = 0; i < num_threads; i++) {
+        thread_data[i].scorer = &scorer;
+        thread_data[i].batch = &batch;
+        thread_data[i].begin = start_user;
+        thread_data[i].end = start_user + users_per_thread + (i < remainder ? 1 : 0);
+
+        if (pthread_create(&threads[i], NULL, recommend_batch_worker, &thread_data[i]) != 0) {
+            fprintf(stderr, "Erro ao criar thread %d\n", i);
+            exit(1);
+        }
+        start_user = thread_data[i].end;
+    }
+    for (int i = 0; i < num_threads; i++) {
+        if (pthread_join(threads[i], NULL) != 0) {
+            fprintf(stderr, "Erro ao aguardar thread %d\n", i);
+            exit(1);
+        }
+    }
+
+    double elapsed = get_time() - start;
+
+    int status = recommend_batch_write(&batch, options.batch_output);
+    if (status == 0) {
+        printf("\n=== Lote de Recomendações ===\n");
+        printf("Usuários: %d (top-%d cada)\n", batch.num_users, batch.top_n);
+        printf("Tempo do lote: %.4f segundos (%.0f usuários/s)\n", elapsed,
+               elapsed > 0 ? batch.num_users / elapsed : 0.0);
+        printf("Número de threads: %d\n", num_threads);
+        printf("Resultados gravados em %s\n", options.batch_output);
+    }
+
+    recommend_batch_free(&batch);
+    return status;
+}
+
+/**
+ * Modo build: grava o modelo calculado para ser servido com --serve
+ */
+int save_model(const char *path, const char *source, double build_seconds) {
+    ModelBuildInfo info = { options_engine_name(options.engine), source, build_seconds,
+                            options.metric };
+
+    if (model_save(path, &ratings, options.top_k > 0 ? &neighbors : NULL,
+                   &similarity_triangle, &info) != 0) {
+        return -1;
+    }
+    printf("Modelo salvo em %s\n", path);
     return 0;
 }
 
-void recommend_for_user(int user_id, int top_n) {
-    float predictions[MAX_ITEMS];
-    memset(predictions, 0, sizeof(predictions));
+/**
+ * --accuracy: compara a similaridade calculada com a referência float64
+ */
+void report_accuracy() {
+    AccuracyReport report;
+    if (accuracy_report(similarity_input, options.top_k > 0 ? NULL : &similarity_triangle,
+                        options.top_k > 0 ? &neighbors : NULL, &report) == 0) {
+        accuracy_print(&report, stdout);
+    }
+}
+
+/**
+ * Modo serve: mapeia um modelo salvo e gera recomendações sem ler as
+ * avaliações nem recalcular a similaridade
+ */
+int serve_model(const char *path) {
+    Model model;
+    double start = get_time();
+
+    if (model_open(&model, path) != 0) {
+        return 1;
+    }
+    // As estruturas globais passam a apontar para as páginas mapeadas
+    ratings = model.ratings;
+    num_users = ratings.num_users;
+    num_items = ratings.num_items;
+    num_ratings = ratings.num_ratings;
+    if (model.header->kind == MODEL_NEIGHBORS) {
+        neighbors = model.neighbors;
+        options.top_k = neighbors.k;
+    } else {
+        dense_similarity = &model.triangle;
+    }
+
+    double elapsed = get_time() - start;
+
+    model_print_info(&model, stdout);
+    printf("Modelo mapeado em %.4f ms\n", elapsed * 1000.0);
+
+    printf("\n=== Exemplos de Recomendações ===\n");
+    recommend_for_user(0, TOP_K);
+    recommend_for_user(1, TOP_K);
+
+    int status = options.batch_users ? recommend_batch_to_file(num_threads_global) : 0;
+    model_close(&model);
+    return status == 0 ? 0 : 1;
+}
+
+typedef struct {
+    const OutOfCoreBlock *block;
+    int worker;
+    int num_workers;
+} OutOfCoreThreadData;
+
+/**
+ * Linhas worker, worker + num_workers, ... do bloco (cíclico: as linhas
+ * do começo do grupo têm mais pares na diagonal)
+ */
+void *outofcore_block_worker(void *arg) {
+    OutOfCoreThreadData *data = (OutOfCoreThreadData *)arg;
+    for (int i = data->worker; i < data->block->rows; i += data->num_workers) {
+        outofcore_block_rows(data->block, i, i + 1, data->worker);
+    }
+    return NULL;
+}
 
-    for (int target_item = 0; target_item < num_items; target_item++) {
-        if (ratings_matrix[user_id][target_item] > 0) {
-            continue;
+/**
+ * Build fora da memória: um conjunto de threads por bloco
+ */
+void compute_outofcore_block(const OutOfCoreBlock *block, void *ctx) {
+    int num_threads = *(const int *)ctx;
+    pthread_t threads[num_threads];
+    OutOfCoreThreadData thread_data[num_threads];
+
+    for (int t = 0; t < num_threads; t++) {
+        thread_data[t].block = block;
+        thread_data[t].worker = t;
+        thread_data[t].num_workers = num_threads;
+        if (pthread_create(&threads[t], NULL, outofcore_block_worker, &thread_data[t]) != 0) {
+            fprintf(stderr, "Erro ao criar thread %d\n", t);
+            exit(1);
         }
+    }
+    for (int t = 0; t < num_threads; t++) {
+        pthread_join(threads[t], NULL);
+    }
+}
 
-        float weighted_sum = 0.0;
-        float similarity_sum = 0.0;
+/**
+ * Modo build fora da memória (--memory-budget): o modelo top-K é montado
+ * direto em disco e depois mapeado para os exemplos, como no --serve
+ */
+int build_out_of_core(const char *path, int num_threads) {
+    OutOfCoreParams params = { options.memory_budget, options.spill_dir, options.top_k,
+                               options.min_similarity, options.metric, num_threads };
+    ModelBuildInfo info = { "outofcore", path, 0.0, options.metric };
+    OutOfCoreStats stats;
+
+    printf("Calculando vizinhos fora da memória com %d threads (orçamento de %.1f MB)...\n",
+           num_threads, options.memory_budget / 1e6);
+    if (outofcore_build(path, options.save_model_path, &params, &info, compute_outofcore_block,
+                        &num_threads, &stats) != 0) {
+        return 1;
+    }
 
-        for (int rated_item = 0; rated_item < num_items; rated_item++) {
-            float user_rating = ratings_matrix[user_id][rated_item];
-            
-            if (user_rating > 0) {
-                float sim = similarity_matrix[target_item][rated_item];
-                weighted_sum += sim * user_rating;
-                similarity_sum += fabs(sim);
+    printf("\n=== Resultados ===\n");
+    printf("Carregados: %d usuários, %d itens, %d avaliações\n",
+           stats.num_users, stats.num_items, stats.num_ratings);
+    printf("Tempo de execução: %.4f segundos\n", stats.sort_seconds + stats.similarity_seconds);
+    printf("Número de threads: %d\n", num_threads);
+    printf("Métrica: %s\n", metric_name(options.metric));
+    printf("Kernel SIMD: %s\n", simd_level_name(simd_level()));
+    printf("Índice de vizinhos: top-%d por item\n", options.top_k);
+    outofcore_print_stats(&stats, &params, stdout);
+    printf("Número de comparações: %lld pares com avaliador comum de %lld\n",
+           stats.common_pairs, (long long)stats.num_items * (stats.num_items - 1) / 2);
+    printf("Modelo salvo em %s\n\n", options.save_model_path);
+
+    return serve_model(options.save_model_path);
+}
+
+/**
+ * Grava a linha completa recalculada de um item afetado pelo delta.
+ * Cada thread só escreve os pares do seu item com itens não alterados
+ * ou de índice maior, então não há escritas concorrentes.
+ */
+void store_updated_row(int item, const float *row) {
+    if (options.top_k > 0) {
+        neighbor_index_reset_row(&neighbors, item);
+        for (int j = 0; j < num_items; j++) {
+            neighbor_index_offer(&neighbors, item, j, row[j]);
+        }
+    } else {
+        for (int j = 0; j < num_items; j++) {
+            // O par com outro item alterado é escrito só pelo de menor índice
+            if (j != item && (!update_is_row[j] || item < j)) {
+                size_t k = item < j ? triangle_index(num_items, item, j)
+                                    : triangle_index(num_items, j, item);
+                similarity_triangle.values[k] = row[j];
             }
         }
+    }
+}
+
+typedef struct {
+    int begin;
+    int end;
+} UpdateThreadData;
 
-        if (similarity_sum > 0) {
-            predictions[target_item] = weighted_sum / similarity_sum;
+/**
+ * Recalcula as linhas update_rows[begin .. end - 1]
+ */
+void *update_rows_worker(void *arg) {
+    UpdateThreadData *data = (UpdateThreadData *)arg;
+
+    RowWorkspace ws;
+    if (row_workspace_init(&ws, num_items) != 0) {
+        exit(1);
+    }
+    for (int r = data->begin; r < data->end; r++) {
+        similarity_item_row(similarity_input, update_rows[r], &ws);
+        store_updated_row(update_rows[r], ws.row);
+    }
+    row_workspace_free(&ws);
+
+    pthread_exit(NULL);
+}
+
+/**
+ * Atualização incremental: aplica um delta de avaliações a um modelo salvo
+ * e recalcula em paralelo apenas as linhas dos itens afetados
+ */
+int update_model(const char *path, int num_threads) {
+    Model model;
+    Rating *delta;
+    int count;
+    long long bytes;
+
+    if (model_open(&model, path) != 0) {
+        return 1;
+    }
+    if (rating_delta_check_ids(&model.ratings, options.remap_ids) != 0) {
+        model_close(&model);
+        return 1;
+    }
+    int load_threads = options.load_threads > 0 ? options.load_threads : num_threads;
+    if (parse_ratings_file(options.update_path, 0, load_threads, &delta, &count, &bytes) != 0) {
+        model_close(&model);
+        return 1;
+    }
+    int status = rating_store_apply_delta(&ratings, &model.ratings, delta, count, &changes);
+    free(delta);
+    if (status != 0) {
+        model_close(&model);
+        return 1;
+    }
+
+    num_users = ratings.num_users;
+    num_items = ratings.num_items;
+    num_ratings = ratings.num_ratings;
+    if (model.header->kind == MODEL_NEIGHBORS) {
+        if (model_copy_neighbors(&model, &neighbors, num_items) != 0) {
+            exit(1);
+        }
+        options.top_k = neighbors.k;
+    } else {
+        if (model_copy_triangle(&model, &similarity_triangle, num_items) != 0) {
+            exit(1);
         }
     }
+    model_print_info(&model, stdout);
 
+    // A similaridade atualizada usa a métrica do modelo, com médias refeitas
+    options.metric = (SimilarityMetric)model.header->metric;
+    if (prepare_metric(options.metric) != 0) {
+        exit(1);
+    }
 
-    ItemSimilarity recommendations[MAX_ITEMS];
-    int count = 0;
-    
-    for (int i = 0; i < num_items; i++) {
-        if (predictions[i] > 0) {
-            recommendations[count].item_id = i;
-            recommendations[count].similarity = predictions[i];
-            count++;
+    // Matriz densa: só as linhas alteradas; top-K: todas as listas tocadas
+    int num_rows = rating_delta_rows(&changes, &ratings, options.metric, options.top_k,
+                                     &update_rows, &update_is_row);
+
+    double start = get_time();
+
+    pthread_t threads[num_threads];
+    UpdateThreadData thread_data[num_threads];
+    int rows_per_thread = num_rows / num_threads;
+    int remainder = num_rows % num_threads;
+
+    int start_row = 0;
+    for (int i = 0; i < num_threads; i++) {
+        thread_data[i].begin = start_row;
+        thread_data[i].end = start_row + rows_per_thread + (i < remainder ? 1 : 0);
+
+        if (pthread_create(&threads[i], NULL, update_rows_worker, &thread_data[i]) != 0) {
+            fprintf(stderr, "Erro ao criar thread %d\n", i);
+            exit(1);
+        }
+        start_row = thread_data[i].end;
+    }
+    for (int i = 0; i < num_threads; i++) {
+        if (pthread_join(threads[i], NULL) != 0) {
+            fprintf(stderr, "Erro ao aguardar thread %d\n", i);
+            exit(1);
         }
     }
 
-    qsort(recommendations, count, sizeof(ItemSimilarity), compare_similarity);
+    if (options.top_k > 0) {
+        neighbor_index_finalize(&neighbors);
+    } else if (packed_triangle_convert(&similarity_triangle, model.triangle.precision) != 0) {
+        exit(1);  // o modelo atualizado mantém a precisão do original
+    }
 
-    printf("\nTop %d recomendações para usuário %d:\n", top_n, user_id);
-    for (int i = 0; i < top_n && i < count; i++) {
-        printf("  Item %d: score %.4f\n", 
-               recommendations[i].item_id, 
-               recommendations[i].similarity);
+    double elapsed = get_time() - start;
+
+    printf("\n=== Atualização Incremental ===\n");
+    printf("Delta: %d avaliações alteradas de %d usuários (%s)\n",
+           changes.num_updates, changes.num_users, options.update_path);
+    printf("Linhas recalculadas: %d de %d itens (%.1f%%)\n", num_rows, num_items,
+           num_items > 0 ? 100.0 * num_rows / num_items : 0.0);
+    printf("Tempo de execução: %.4f segundos\n", elapsed);
+    printf("Número de threads: %d\n", num_threads);
+
+    if (options.save_model_path) {
+        ModelBuildInfo info = { "incremental", model.header->source, elapsed, options.metric };
+        if (model_save(options.save_model_path, &ratings, options.top_k > 0 ? &neighbors : NULL,
+                       &similarity_triangle, &info) != 0) {
+            model_close(&model);
+            return 1;
+        }
+        printf("Modelo salvo em %s\n", options.save_model_path);
+    }
+    model_close(&model);
+
+    printf("\n=== Exemplos de Recomendações ===\n");
+    recommend_for_user(0, TOP_K);
+    recommend_for_user(1, TOP_K);
+
+    rating_delta_free(&changes);
+    if (options.batch_users && recommend_batch_to_file(num_threads) != 0) {
+        return 1;
     }
+    return 0;
 }
 
 int main(int argc, char *argv[]) {
-    if (argc < 3) {
-        fprintf(stderr, "Uso: %s <arquivo_avaliacoes> <num_threads>\n", argv[0]);
+    options_init(&options);
+    if (argc < 3 || options_parse(&options, argc, argv, 3) != 0) {
+        fprintf(stderr, "Uso: %s <arquivo_avaliacoes> <num_threads> [opções]\n", argv[0]);
+        options_print_usage(stderr);
+        return 1;
+    }
+
+    if (simd_init(options.simd) != 0) {
+        fprintf(stderr, "CPU sem suporte aos kernels %s\n", simd_level_name(options.simd));
         return 1;
     }
 
@@ -254,7 +780,17 @@ int main(int argc, char *argv[]) {
     printf("=== Sistema de Recomendação (Pthreads) ===\n");
     printf("Threads: %d\n\n", num_threads);
 
-    if (load_ratings(argv[1]) != 0) {
+    if (options.update_path) {
+        return update_model(argv[1], num_threads);
+    }
+    if (options.serve) {
+        return serve_model(argv[1]);
+    }
+    if (options.memory_budget > 0) {
+        return build_out_of_core(argv[1], num_threads);
+    }
+
+    if (load_ratings(argv[1], num_threads) != 0 || prepare_metric(options.metric) != 0) {
         return 1;
     }
 
@@ -268,12 +804,43 @@ int main(int argc, char *argv[]) {
     printf("\n=== Resultados ===\n");
     printf("Tempo de execução: %.4f segundos\n", elapsed);
     printf("Número de threads: %d\n", num_threads);
-    printf("Número de comparações: %d\n", (num_items * (num_items - 1)) / 2);
+    printf("Motor de similaridade: %s\n", options_engine_name(options.engine));
+    printf("Métrica: %s\n", metric_name(options.metric));
+    printf("Kernel SIMD: %s\n", simd_level_name(simd_level()));
+    printf("Acumuladores: %s\n", ACCUM_NAME);
+    if (options.top_k > 0) {
+        printf("Índice de vizinhos: top-%d por item\n", options.top_k);
+    } else {
+        printf("Matriz de similaridade: triângulo em %s (%.1f MB)\n",
+               triangle_precision_name(similarity_triangle.precision),
+               packed_triangle_bytes(num_items, similarity_triangle.precision) / 1e6);
+    }
+    if (options.engine == ENGINE_LSH) {
+        printf("Número de comparações: %lld candidatos LSH de %lld pares\n",
+               lsh_candidates.num_pairs, (long long)num_items * (num_items - 1) / 2);
+    } else if (options.engine == ENGINE_ALLPAIRS) {
+        printf("Número de comparações: %lld pares com avaliador comum de %lld\n",
+               common_pairs, (long long)num_items * (num_items - 1) / 2);
+    } else {
+        printf("Número de comparações: %lld\n", (long long)num_items * (num_items - 1) / 2);
+    }
+
+    if (options.save_model_path && save_model(options.save_model_path, argv[1], elapsed) != 0) {
+        return 1;
+    }
+
+    if (options.accuracy) {
+        report_accuracy();
+    }
 
     printf("\n=== Exemplos de Recomendações ===\n");
     recommend_for_user(0, TOP_K);
     recommend_for_user(1, TOP_K);
 
+    if (options.batch_users && recommend_batch_to_file(num_threads) != 0) {
+        return 1;
+    }
+
     pthread_mutex_destroy(&progress_mutex);
 
     return 0;